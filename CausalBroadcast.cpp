@@ -0,0 +1,160 @@
+#include "CausalBroadcast.h"
+#include "Messages.h"
+
+namespace {
+
+void reportReadable(Node &node, const vector<CausalBroadcast::Envelope> &delivered) {
+    if (!node.onBroadcastReadable) {
+        return;
+    }
+    for (auto &envelope : delivered) {
+        if (envelope.message.is_number_integer()) {
+            node.onBroadcastReadable(envelope.message.get<int64_t>());
+        }
+    }
+}
+
+}
+
+json CausalBroadcast::Envelope::toJson() const {
+    return {{"origin", origin}, {"message", message}, {"clock", clock.entries()}};
+}
+
+CausalBroadcast::Envelope CausalBroadcast::Envelope::fromJson(const json &j) {
+    return {j["origin"], j["message"], VectorClock(j["clock"].get<map<string, int>>())};
+}
+
+size_t CausalBroadcast::DotKeyHash::operator()(const DotKey &dot) const {
+    return hash<string>{}(dot.first) ^ (static_cast<size_t>(dot.second) * 0x9E3779B97F4A7C15ULL);
+}
+
+optional<CausalBroadcast::DotKey> CausalBroadcast::missingDependency(const Envelope &envelope) const {
+    for (auto &[process, time] : envelope.clock.entries()) {
+        // the origin's entry includes the message itself, so only its predecessor must be delivered
+        int needed = process == envelope.origin ? time - 1 : time;
+        if (delivered.getTime(process) < needed) {
+            return DotKey{process, needed};
+        }
+    }
+    return nullopt;
+}
+
+void CausalBroadcast::deliverLocked(Envelope envelope, vector<Envelope> &out) {
+    vector<Envelope> ready{move(envelope)};
+    while (!ready.empty()) {
+        Envelope next = move(ready.back());
+        ready.pop_back();
+        DotKey dot{next.origin, next.clock.getTime(next.origin)};
+        delivered.increment(next.origin);
+        log.push_back(next.message);
+        out.push_back(move(next));
+
+        auto it = waiting.find(dot);
+        if (it == waiting.end()) {
+            continue;
+        }
+        vector<DotKey> woken = move(it->second);
+        waiting.erase(it);
+        for (auto &key : woken) {
+            auto p = pending.find(key);
+            if (auto missing = missingDependency(p->second)) {
+                waiting[*missing].push_back(key);
+                continue;
+            }
+            ready.push_back(move(p->second));
+            pending.erase(p);
+        }
+    }
+}
+
+CausalBroadcast::Envelope CausalBroadcast::broadcast(const string &self, json message) {
+    lock_guard<mutex> lock(mtx);
+    VectorClock clock = delivered;
+    clock.increment(self);
+    vector<Envelope> out;
+    deliverLocked({self, move(message), move(clock)}, out);
+    return move(out.front());
+}
+
+vector<CausalBroadcast::Envelope> CausalBroadcast::receive(Envelope envelope) {
+    lock_guard<mutex> lock(mtx);
+    vector<Envelope> out;
+    DotKey dot{envelope.origin, envelope.clock.getTime(envelope.origin)};
+    if (delivered.getTime(dot.first) >= dot.second || pending.contains(dot)) {
+        return out;
+    }
+    if (auto missing = missingDependency(envelope)) {
+        waiting[*missing].push_back(dot);
+        pending.emplace(dot, move(envelope));
+        return out;
+    }
+    deliverLocked(move(envelope), out);
+    return out;
+}
+
+json CausalBroadcast::read() const {
+    lock_guard<mutex> lock(mtx);
+    return log;
+}
+
+size_t CausalBroadcast::pendingCount() const {
+    lock_guard<mutex> lock(mtx);
+    return pending.size();
+}
+
+void CausalBroadcast::gossip(Node &node, const vector<Envelope> &batch, const string &except) {
+    json messages = json::array();
+    for (auto &envelope : batch) {
+        messages.push_back(envelope.toJson());
+    }
+    set<string> peersToSendTo;
+    {
+        lock_guard<mutex> lock(node.messagesMutex);
+        for (auto &peer : node.peers) {
+            if (peer != except) {
+                peersToSendTo.insert(peer);
+            }
+        }
+    }
+    while (!peersToSendTo.empty()) {
+        for (auto it = peersToSendTo.begin(); it != peersToSendTo.end();) {
+            json reply = node.rpc(*it, {{"type", "causal_broadcast"}, {"messages", messages}});
+            if (reply["type"] == "causal_broadcast_ok") {
+                it = peersToSendTo.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!peersToSendTo.empty()) {
+            // wait a bit before trying again
+            node.scheduler->sleepFor(chrono::milliseconds(100));
+        }
+    }
+}
+
+void CausalBroadcast::registerHandlers(Node &node) {
+    node.on<Broadcast>([this, &node](const Request<Broadcast>& req) {
+        node.reply(req, BroadcastOk{});
+        Envelope envelope = broadcast(node.nodeId, req.body.message);
+        reportReadable(node, {envelope});
+        gossip(node, {envelope}, node.nodeId);
+    });
+
+    node.on("causal_broadcast", [this, &node](const json& req) {
+        vector<Envelope> delivered;
+        for (auto &m : req["body"]["messages"]) {
+            vector<Envelope> out = receive(Envelope::fromJson(m));
+            move(out.begin(), out.end(), back_inserter(delivered));
+        }
+        reportReadable(node, delivered);
+        // pending messages are held here until delivered, so the sender need not resend them
+        node.reply(req, {{"type", "causal_broadcast_ok"}});
+        if (!delivered.empty()) {
+            gossip(node, delivered, req["src"]);
+        }
+    });
+
+    node.on<Read>([this, &node](const Request<Read>& req) {
+        node.reply(req, {{"type", "read_ok"}, {"messages", read()}});
+    });
+}
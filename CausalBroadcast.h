@@ -0,0 +1,64 @@
+#ifndef FLYIO_CHALLENGES_CAUSALBROADCAST_H
+#define FLYIO_CHALLENGES_CAUSALBROADCAST_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "node.h"
+#include "VectorClock.h"
+
+// Causal-order delivery for the broadcast workload.
+// Every message carries the VectorClock of its origin at the time it was broadcast, with the origin's
+// own entry counting the message itself. A node delivers a message once it has delivered everything
+// that clock names; until then it waits in `pending`, filed under the one dot (node, counter) it is
+// still missing. Delivering a dot wakes only the messages filed under it, and each of those is either
+// delivered or refiled under its next missing dot, so a backlog of thousands after a partition heals
+// drains without rescanning the buffer on every arrival.
+class CausalBroadcast {
+public:
+    struct Envelope {
+        string origin;
+        json message;
+        VectorClock clock;
+
+        [[nodiscard]] json toJson() const;
+        static Envelope fromJson(const json &j);
+    };
+
+    // The counter-th message broadcast by node.
+    using DotKey = pair<string, int>;
+
+    struct DotKeyHash {
+        size_t operator()(const DotKey &dot) const;
+    };
+
+    // Delivers a message broadcast by this node and returns it as it should be gossiped.
+    Envelope broadcast(const string &self, json message);
+    // Buffers or delivers a message from another node; returns everything delivered as a result, in
+    // delivery order. Messages already delivered or already pending are ignored.
+    vector<Envelope> receive(Envelope envelope);
+    // Messages in the order they were delivered here.
+    [[nodiscard]] json read() const;
+    [[nodiscard]] size_t pendingCount() const;
+    void registerHandlers(Node &node);
+
+private:
+    mutable mutex mtx;
+    // what has been delivered: entry n is the number of messages from n delivered so far
+    VectorClock delivered;
+    vector<json> log;
+    unordered_map<DotKey, Envelope, DotKeyHash> pending;
+    // missing dot -> pending messages waiting for it
+    unordered_map<DotKey, vector<DotKey>, DotKeyHash> waiting;
+
+    [[nodiscard]] optional<DotKey> missingDependency(const Envelope &envelope) const;
+    void deliverLocked(Envelope envelope, vector<Envelope> &out);
+    void gossip(Node &node, const vector<Envelope> &batch, const string &except);
+};
+
+#endif //FLYIO_CHALLENGES_CAUSALBROADCAST_H
@@ -0,0 +1,123 @@
+#include "ClockKernels.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FLYIO_CLOCK_KERNELS_X86 1
+#endif
+
+namespace {
+
+void scalarMaxInto(int32_t *dst, const int32_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+
+void scalarCompare(const int32_t *a, const int32_t *b, size_t n, bool &lesser, bool &greater) {
+    for (size_t i = 0; i < n; i++) {
+        lesser |= a[i] < b[i];
+        greater |= a[i] > b[i];
+    }
+}
+
+#ifdef FLYIO_CLOCK_KERNELS_X86
+
+__attribute__((target("sse4.1")))
+void sse41MaxInto(int32_t *dst, const int32_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_max_epi32(d, s));
+    }
+    scalarMaxInto(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void sse41Compare(const int32_t *a, const int32_t *b, size_t n, bool &lesser, bool &greater) {
+    __m128i lt = _mm_setzero_si128();
+    __m128i gt = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        lt = _mm_or_si128(lt, _mm_cmplt_epi32(x, y));
+        gt = _mm_or_si128(gt, _mm_cmpgt_epi32(x, y));
+    }
+    lesser |= !_mm_testz_si128(lt, lt);
+    greater |= !_mm_testz_si128(gt, gt);
+    scalarCompare(a + i, b + i, n - i, lesser, greater);
+}
+
+__attribute__((target("avx2")))
+void avx2MaxInto(int32_t *dst, const int32_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_max_epi32(d, s));
+    }
+    for (; i < n; i++) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2Compare(const int32_t *a, const int32_t *b, size_t n, bool &lesser, bool &greater) {
+    __m256i lt = _mm256_setzero_si256();
+    __m256i gt = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        lt = _mm256_or_si256(lt, _mm256_cmpgt_epi32(y, x));
+        gt = _mm256_or_si256(gt, _mm256_cmpgt_epi32(x, y));
+    }
+    lesser |= !_mm256_testz_si256(lt, lt);
+    greater |= !_mm256_testz_si256(gt, gt);
+    for (; i < n; i++) {
+        lesser |= a[i] < b[i];
+        greater |= a[i] > b[i];
+    }
+}
+
+#endif
+
+}
+
+const ClockKernels &ClockKernels::scalar() {
+    static const ClockKernels kernels{"scalar", scalarMaxInto, scalarCompare};
+    return kernels;
+}
+
+const ClockKernels *ClockKernels::sse41() {
+#ifdef FLYIO_CLOCK_KERNELS_X86
+    static const ClockKernels kernels{"sse4.1", sse41MaxInto, sse41Compare};
+    return __builtin_cpu_supports("sse4.1") ? &kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const ClockKernels *ClockKernels::avx2() {
+#ifdef FLYIO_CLOCK_KERNELS_X86
+    static const ClockKernels kernels{"avx2", avx2MaxInto, avx2Compare};
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.1") ? &kernels : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+const ClockKernels &ClockKernels::best(size_t n) {
+    static const ClockKernels *const wide = avx2();
+    static const ClockKernels *const narrow = sse41();
+    if (n >= 8 && wide != nullptr) {
+        return *wide;
+    }
+    if (n >= 4 && narrow != nullptr) {
+        return *narrow;
+    }
+    return scalar();
+}
@@ -0,0 +1,26 @@
+#ifndef FLYIO_CHALLENGES_CLOCKKERNELS_H
+#define FLYIO_CHALLENGES_CLOCKKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Element-wise kernels behind CompactVectorClock. best() picks a variant by clock length; the others stay
+// reachable for benchmarking.
+struct ClockKernels {
+    const char *name;
+    // dst[i] = max(dst[i], src[i])
+    void (*maxInto)(int32_t *dst, const int32_t *src, size_t n);
+    // Sets lesser if any a[i] < b[i] and greater if any a[i] > b[i].
+    void (*compare)(const int32_t *a, const int32_t *b, size_t n, bool &lesser, bool &greater);
+
+    static const ClockKernels &scalar();
+    // nullptr when the CPU (or target) lacks the instruction set
+    static const ClockKernels *sse41();
+    static const ClockKernels *avx2();
+    // The widest variant the CPU supports that fills at least one vector with n entries: AVX2 from 8,
+    // SSE4.1 from 4, scalar below that. Shorter clocks never enter the wider loop, so it would only add
+    // its setup to the scalar tail.
+    static const ClockKernels &best(size_t n);
+};
+
+#endif //FLYIO_CHALLENGES_CLOCKKERNELS_H
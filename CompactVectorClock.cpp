@@ -0,0 +1,141 @@
+#include "CompactVectorClock.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "ClockKernels.h"
+
+CompactVectorClock::CompactVectorClock(size_t nodes) : ticks(nodes, 0) {}
+
+CompactVectorClock::CompactVectorClock(std::vector<int32_t> ticks) : ticks(std::move(ticks)) {}
+
+std::ostream &operator<<(std::ostream &os, const CompactVectorClock &vc) {
+    os << "[";
+    for (size_t i = 0; i < vc.ticks.size(); i++) {
+        if (i != 0) {
+            os << ", ";
+        }
+        os << vc.ticks[i];
+    }
+    os << "]";
+    return os;
+}
+
+void CompactVectorClock::increment(uint32_t ordinal) {
+    if (ordinal >= ticks.size()) {
+        ticks.resize(ordinal + 1, 0);
+    }
+    ticks[ordinal]++;
+}
+
+void CompactVectorClock::observe(uint32_t ordinal, int32_t ticks) {
+    if (ordinal >= this->ticks.size()) {
+        this->ticks.resize(ordinal + 1, 0);
+    }
+    this->ticks[ordinal] = std::max(this->ticks[ordinal], ticks);
+}
+
+void CompactVectorClock::update(const CompactVectorClock &other) {
+    if (other.ticks.size() > ticks.size()) {
+        ticks.resize(other.ticks.size(), 0);
+    }
+    ClockKernels::best(other.ticks.size()).maxInto(ticks.data(), other.ticks.data(), other.ticks.size());
+}
+
+int32_t CompactVectorClock::getTime(uint32_t ordinal) const {
+    return ordinal < ticks.size() ? ticks[ordinal] : 0;
+}
+
+ClockOrder CompactVectorClock::compare(const CompactVectorClock &other) const {
+    size_t common = std::min(ticks.size(), other.ticks.size());
+    const int32_t *ours = ticks.data();
+    const int32_t *theirs = other.ticks.data();
+    bool hasLesser = false;
+    bool hasGreater = false;
+    ClockKernels::best(common).compare(ours, theirs, common, hasLesser, hasGreater);
+    for (size_t i = common; i < ticks.size(); i++) {
+        hasGreater |= ours[i] > 0;
+    }
+    for (size_t i = common; i < other.ticks.size(); i++) {
+        hasLesser |= theirs[i] > 0;
+    }
+    if (hasLesser && hasGreater) {
+        return ClockOrder::Concurrent;
+    }
+    if (hasLesser) {
+        return ClockOrder::Less;
+    }
+    return hasGreater ? ClockOrder::Greater : ClockOrder::Equal;
+}
+
+bool CompactVectorClock::isConcurrent(const CompactVectorClock &other) const {
+    return compare(other) == ClockOrder::Concurrent;
+}
+
+bool CompactVectorClock::isLessThan(const CompactVectorClock &other) const {
+    return compare(other) == ClockOrder::Less;
+}
+
+bool CompactVectorClock::isGreaterThan(const CompactVectorClock &other) const {
+    return compare(other) == ClockOrder::Greater;
+}
+
+bool CompactVectorClock::isEqual(const CompactVectorClock &other) const {
+    return compare(other) == ClockOrder::Equal;
+}
+
+int64_t CompactVectorClock::total() const {
+    int64_t sum = 0;
+    for (int32_t t : ticks) {
+        sum += t;
+    }
+    return sum;
+}
+
+const std::vector<int32_t> &CompactVectorClock::entries() const {
+    return ticks;
+}
+
+VectorClock CompactVectorClock::toVectorClock(const NodeIndex &index) const {
+    std::map<std::string, int> entries;
+    for (uint32_t i = 0; i < ticks.size() && i < index.size(); i++) {
+        if (ticks[i] != 0) {
+            entries[index.name(i)] = ticks[i];
+        }
+    }
+    return VectorClock(std::move(entries));
+}
+
+std::vector<int32_t> CompactVectorClock::deltaFrom(const CompactVectorClock &base) const {
+    size_t n = std::max(ticks.size(), base.ticks.size());
+    // room for every entry to differ, so the delta is allocated once
+    std::vector<int32_t> delta;
+    delta.reserve(2 * n);
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t t = getTime(i);
+        if (t != base.getTime(i)) {
+            delta.push_back(static_cast<int32_t>(i));
+            delta.push_back(t);
+        }
+    }
+    return delta;
+}
+
+CompactVectorClock CompactVectorClock::fromDelta(const CompactVectorClock &base, const std::vector<int32_t> &delta,
+                                                 size_t nodes) {
+    if (delta.size() % 2 != 0) {
+        throw std::invalid_argument("vector clock delta must hold ordinal/ticks pairs");
+    }
+    CompactVectorClock clock = base;
+    for (size_t i = 0; i < delta.size(); i += 2) {
+        if (delta[i] < 0 || static_cast<size_t>(delta[i]) >= nodes) {
+            throw std::invalid_argument("vector clock delta names ordinal " + std::to_string(delta[i]) + " of " +
+                                        std::to_string(nodes) + " nodes");
+        }
+        auto ordinal = static_cast<uint32_t>(delta[i]);
+        if (ordinal >= clock.ticks.size()) {
+            clock.ticks.resize(ordinal + 1, 0);
+        }
+        clock.ticks[ordinal] = delta[i + 1];
+    }
+    return clock;
+}
@@ -0,0 +1,44 @@
+#ifndef FLYIO_CHALLENGES_COMPACTVECTORCLOCK_H
+#define FLYIO_CHALLENGES_COMPACTVECTORCLOCK_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "NodeIndex.h"
+#include "VectorClock.h"
+
+// Vector clock stored as a flat array indexed by NodeIndex ordinal.
+// Missing trailing entries count as 0, so clocks created before init compare correctly.
+// update() and compare() run on the SSE4.1/AVX2 kernels from ClockKernels when the CPU has them and the
+// clock is long enough to fill a vector.
+class CompactVectorClock {
+private:
+    std::vector<int32_t> ticks;
+public:
+    CompactVectorClock() = default;
+    explicit CompactVectorClock(size_t nodes);
+    explicit CompactVectorClock(std::vector<int32_t> ticks);
+    void increment(uint32_t ordinal);
+    // Raises one entry to at least `ticks`.
+    void observe(uint32_t ordinal, int32_t ticks);
+    void update(const CompactVectorClock &other);
+    [[nodiscard]] int32_t getTime(uint32_t ordinal) const;
+    [[nodiscard]] ClockOrder compare(const CompactVectorClock &other) const;
+    [[nodiscard]] bool isConcurrent(const CompactVectorClock &other) const;
+    [[nodiscard]] bool isLessThan(const CompactVectorClock &other) const;
+    [[nodiscard]] bool isGreaterThan(const CompactVectorClock &other) const;
+    [[nodiscard]] bool isEqual(const CompactVectorClock &other) const;
+    [[nodiscard]] int64_t total() const;
+    [[nodiscard]] const std::vector<int32_t> &entries() const;
+    [[nodiscard]] VectorClock toVectorClock(const NodeIndex &index) const;
+    // Flat [ordinal, ticks, ordinal, ticks, ...] for every entry that differs from `base`, so a clock
+    // costs space proportional to what changed since a clock the receiver already holds.
+    [[nodiscard]] std::vector<int32_t> deltaFrom(const CompactVectorClock &base) const;
+    // Rebuilds the clock that produced `delta` from the same base. Deltas come off the wire, so an
+    // ordinal outside [0, nodes) is rejected rather than grown into.
+    [[nodiscard]] static CompactVectorClock fromDelta(const CompactVectorClock &base, const std::vector<int32_t> &delta,
+                                                      size_t nodes);
+    friend std::ostream &operator<<(std::ostream &os, const CompactVectorClock &vc);
+};
+
+#endif //FLYIO_CHALLENGES_COMPACTVECTORCLOCK_H
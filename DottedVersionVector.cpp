@@ -0,0 +1,75 @@
+#include "DottedVersionVector.h"
+
+#include <algorithm>
+
+namespace {
+
+bool seenBy(const CompactVectorClock &clock, const Dot &dot) {
+    return clock.getTime(dot.node) >= dot.counter;
+}
+
+}
+
+bool DottedVersionVector::covers(const Dot &dot) const {
+    return seenBy(ctx, dot);
+}
+
+const CompactVectorClock &DottedVersionVector::context() const {
+    return ctx;
+}
+
+const std::vector<DottedVersionVector::Sibling> &DottedVersionVector::siblings() const {
+    return values;
+}
+
+Dot DottedVersionVector::update(const CompactVectorClock &seen, uint32_t node, int64_t value,
+                                HybridLogicalClock::Timestamp timestamp) {
+    Dot dot{node, ctx.getTime(node) + 1};
+    apply(dot, seen, value, timestamp);
+    return dot;
+}
+
+bool DottedVersionVector::apply(const Dot &dot, const CompactVectorClock &seen, int64_t value,
+                                HybridLogicalClock::Timestamp timestamp) {
+    if (covers(dot)) {
+        return false;
+    }
+    std::erase_if(values, [&seen](const Sibling &s) {
+        return seenBy(seen, s.dot);
+    });
+    values.push_back({dot, value, timestamp});
+    ctx.update(seen);
+    // A node's writes to one key are sequential, so a later dot also covers any we missed.
+    ctx.observe(dot.node, dot.counter);
+    return true;
+}
+
+void DottedVersionVector::sync(const DottedVersionVector &other) {
+    std::vector<Sibling> merged;
+    auto contains = [](const std::vector<Sibling> &list, const Dot &dot) {
+        return std::any_of(list.begin(), list.end(), [&dot](const Sibling &s) { return s.dot == dot; });
+    };
+    for (const Sibling &s : values) {
+        if (!other.covers(s.dot) || contains(other.values, s.dot)) {
+            merged.push_back(s);
+        }
+    }
+    for (const Sibling &s : other.values) {
+        if (!covers(s.dot) && !contains(merged, s.dot)) {
+            merged.push_back(s);
+        }
+    }
+    values = std::move(merged);
+    ctx.update(other.ctx);
+}
+
+const DottedVersionVector::Sibling *DottedVersionVector::winner() const {
+    const Sibling *best = nullptr;
+    for (const Sibling &s : values) {
+        if (best == nullptr || s.timestamp > best->timestamp ||
+            (s.timestamp == best->timestamp && s.dot.node > best->dot.node)) {
+            best = &s;
+        }
+    }
+    return best;
+}
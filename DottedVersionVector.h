@@ -0,0 +1,47 @@
+#ifndef FLYIO_CHALLENGES_DOTTEDVERSIONVECTOR_H
+#define FLYIO_CHALLENGES_DOTTEDVERSIONVECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include "CompactVectorClock.h"
+#include "HybridLogicalClock.h"
+
+// A single write event: the `counter`-th write to this key made on node `node`.
+struct Dot {
+    uint32_t node;
+    int32_t counter;
+
+    bool operator==(const Dot &other) const = default;
+};
+
+// Causal history of one key: the dots it has seen (as a CompactVectorClock context) plus the
+// sibling values no other known write has overwritten. A write names the context it had seen,
+// so it removes exactly the siblings it overwrote; writes that were merely concurrent on other
+// keys never conflict, and a write already covered by the context is dropped on arrival.
+class DottedVersionVector {
+public:
+    struct Sibling {
+        Dot dot;
+        int64_t value;
+        HybridLogicalClock::Timestamp timestamp;
+    };
+
+private:
+    CompactVectorClock ctx;
+    std::vector<Sibling> values;
+
+public:
+    [[nodiscard]] bool covers(const Dot &dot) const;
+    [[nodiscard]] const CompactVectorClock &context() const;
+    [[nodiscard]] const std::vector<Sibling> &siblings() const;
+    // Records a write made on `node` by someone who had seen `seen`, and returns its new dot.
+    Dot update(const CompactVectorClock &seen, uint32_t node, int64_t value, HybridLogicalClock::Timestamp timestamp);
+    // Folds in a write made elsewhere. Returns false, changing nothing, if the dot is already covered.
+    bool apply(const Dot &dot, const CompactVectorClock &seen, int64_t value, HybridLogicalClock::Timestamp timestamp);
+    // Merges another replica's history of the same key.
+    void sync(const DottedVersionVector &other);
+    // Sibling with the highest (timestamp, node); the value a register read returns. nullptr if empty.
+    [[nodiscard]] const Sibling *winner() const;
+};
+
+#endif //FLYIO_CHALLENGES_DOTTEDVERSIONVECTOR_H
@@ -0,0 +1,44 @@
+#include "HashRing.h"
+
+#include <algorithm>
+
+HashRing::HashRing(int virtualNodes) : virtualNodes(virtualNodes) {}
+
+uint64_t HashRing::hash(std::string_view data) {
+    // FNV-1a followed by a splitmix64 finalizer so nearby keys spread around the ring.
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void HashRing::build(const std::vector<std::string> &nodeIds) {
+    nodes = nodeIds;
+    points.clear();
+    points.reserve(nodes.size() * virtualNodes);
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        for (int v = 0; v < virtualNodes; v++) {
+            points.emplace_back(hash(nodes[i] + "#" + std::to_string(v)), i);
+        }
+    }
+    std::sort(points.begin(), points.end());
+}
+
+bool HashRing::empty() const {
+    return points.empty();
+}
+
+const std::string &HashRing::owner(std::string_view key) const {
+    auto it = std::lower_bound(points.begin(), points.end(), std::make_pair(hash(key), uint32_t{0}));
+    if (it == points.end()) {
+        it = points.begin();
+    }
+    return nodes[it->second];
+}
@@ -0,0 +1,25 @@
+#ifndef FLYIO_CHALLENGES_HASHRING_H
+#define FLYIO_CHALLENGES_HASHRING_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Consistent-hash ring mapping keys to node ids. Every node contributes
+// `virtualNodes` points so ownership stays balanced for small clusters.
+class HashRing {
+private:
+    std::vector<std::pair<uint64_t, uint32_t>> points;
+    std::vector<std::string> nodes;
+    int virtualNodes;
+public:
+    explicit HashRing(int virtualNodes = 64);
+    void build(const std::vector<std::string> &nodeIds);
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] const std::string &owner(std::string_view key) const;
+    static uint64_t hash(std::string_view data);
+};
+
+#endif //FLYIO_CHALLENGES_HASHRING_H
@@ -0,0 +1,69 @@
+#include "HybridLogicalClock.h"
+
+#include <algorithm>
+
+HybridLogicalClock::HybridLogicalClock(std::chrono::milliseconds maxSkew, std::function<uint64_t()> physicalMillis)
+        : maxSkew(maxSkew), physicalMillis(std::move(physicalMillis)) {}
+
+HybridLogicalClock::Timestamp HybridLogicalClock::pack(uint64_t physical, uint16_t logical) {
+    return (physical << LogicalBits) | logical;
+}
+
+uint64_t HybridLogicalClock::physical(Timestamp ts) {
+    return ts >> LogicalBits;
+}
+
+uint16_t HybridLogicalClock::logical(Timestamp ts) {
+    return static_cast<uint16_t>(ts & LogicalMask);
+}
+
+uint64_t HybridLogicalClock::wallMillis() {
+    auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count();
+}
+
+// Both update rules reduce to "max of everything seen, plus one tick" on the packed form: a newer
+// physical time resets the logical counter, otherwise the counter increments (carrying into the
+// physical bits if it ever overflows, which keeps timestamps unique and monotonic).
+HybridLogicalClock::Timestamp HybridLogicalClock::now() {
+    Timestamp wall = pack(physicalMillis(), 0);
+    Timestamp old = latest.load();
+    Timestamp next;
+    do {
+        next = std::max(old + 1, wall);
+    } while (!latest.compare_exchange_weak(old, next));
+    return next;
+}
+
+HybridLogicalClock::Timestamp HybridLogicalClock::receive(Timestamp remote) {
+    uint64_t wallMs = physicalMillis();
+    Timestamp bound = pack(wallMs + maxSkew.count(), LogicalMask);
+    if (remote > bound) {
+        // one fast sender must not drag every later local timestamp that far ahead
+        remote = bound;
+        clampedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    Timestamp wall = pack(wallMs, 0);
+    Timestamp old = latest.load();
+    Timestamp next;
+    do {
+        next = std::max({old + 1, remote + 1, wall});
+    } while (!latest.compare_exchange_weak(old, next));
+    return next;
+}
+
+bool HybridLogicalClock::withinSkew(Timestamp remote) const {
+    return physical(remote) <= physicalMillis() + maxSkew.count();
+}
+
+void HybridLogicalClock::setPhysicalClock(std::function<uint64_t()> millis) {
+    physicalMillis = std::move(millis);
+}
+
+uint64_t HybridLogicalClock::clamped() const {
+    return clampedCount.load(std::memory_order_relaxed);
+}
+
+HybridLogicalClock::Timestamp HybridLogicalClock::last() const {
+    return latest.load();
+}
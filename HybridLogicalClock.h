@@ -0,0 +1,47 @@
+#ifndef FLYIO_CHALLENGES_HYBRIDLOGICALCLOCK_H
+#define FLYIO_CHALLENGES_HYBRIDLOGICALCLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// Hybrid logical clock: 48 bits of wall-clock milliseconds and a 16-bit logical counter packed
+// into one uint64_t, so timestamps are constant-size, totally ordered by plain integer comparison,
+// and consistent with causality across nodes that exchange them.
+// TxnStore stamps versions with it. Log records need no stamp: their owner orders them by offset.
+class HybridLogicalClock {
+public:
+    using Timestamp = uint64_t;
+
+    static constexpr int LogicalBits = 16;
+    static constexpr Timestamp LogicalMask = (Timestamp{1} << LogicalBits) - 1;
+
+    explicit HybridLogicalClock(std::chrono::milliseconds maxSkew = std::chrono::milliseconds(500),
+                                std::function<uint64_t()> physicalMillis = wallMillis);
+
+    // Timestamp for a local event or an outgoing message.
+    Timestamp now();
+    // Advances past a timestamp received from another node. Never throws: if the sender's physical time
+    // is more than maxSkew ahead of ours, the clock only advances to the skew bound and clamped() counts it.
+    Timestamp receive(Timestamp remote);
+    [[nodiscard]] bool withinSkew(Timestamp remote) const;
+    // receive() calls whose timestamp was beyond the skew bound
+    [[nodiscard]] uint64_t clamped() const;
+    [[nodiscard]] Timestamp last() const;
+    // Replaces the physical time source; call before the clock is shared between threads.
+    void setPhysicalClock(std::function<uint64_t()> millis);
+
+    static Timestamp pack(uint64_t physical, uint16_t logical);
+    static uint64_t physical(Timestamp ts);
+    static uint16_t logical(Timestamp ts);
+    static uint64_t wallMillis();
+
+private:
+    std::atomic<Timestamp> latest{0};
+    std::atomic<uint64_t> clampedCount{0};
+    std::chrono::milliseconds maxSkew;
+    std::function<uint64_t()> physicalMillis;
+};
+
+#endif //FLYIO_CHALLENGES_HYBRIDLOGICALCLOCK_H
@@ -0,0 +1,291 @@
+#include "JsonReader.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+void appendUtf8(std::string &out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+}
+
+void JsonReader::fail(std::string_view what) const {
+    throw std::runtime_error("at JSON offset " + std::to_string(pos) + ": " + std::string(what));
+}
+
+void JsonReader::skipWhitespace() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) {
+        pos++;
+    }
+}
+
+char JsonReader::next() {
+    skipWhitespace();
+    if (pos == text.size()) {
+        fail("unexpected end");
+    }
+    return text[pos];
+}
+
+void JsonReader::expect(char c) {
+    if (next() != c) {
+        fail(std::string("expected '") + c + "'");
+    }
+    pos++;
+}
+
+void JsonReader::expectLiteral(std::string_view literal) {
+    skipWhitespace();
+    if (text.substr(pos, literal.size()) != literal) {
+        fail("expected " + std::string(literal));
+    }
+    pos += literal.size();
+}
+
+JsonReader::Kind JsonReader::peek() {
+    switch (next()) {
+        case 'n': return Kind::Null;
+        case 't':
+        case 'f': return Kind::Bool;
+        case '"': return Kind::String;
+        case '[': return Kind::Array;
+        case '{': return Kind::Object;
+        default: return Kind::Number;
+    }
+}
+
+void JsonReader::beginObject() {
+    expect('{');
+    afterOpen = true;
+}
+
+std::optional<std::string_view> JsonReader::nextKey() {
+    if (next() == '}') {
+        pos++;
+        afterOpen = false;
+        return std::nullopt;
+    }
+    if (!afterOpen) {
+        expect(',');
+    }
+    afterOpen = false;
+    if (next() != '"') {
+        fail("expected a key");
+    }
+    scratch.clear();
+    std::string_view key = readStringView(scratch);
+    expect(':');
+    return key;
+}
+
+void JsonReader::beginArray() {
+    expect('[');
+    afterOpen = true;
+}
+
+bool JsonReader::nextElement() {
+    if (next() == ']') {
+        pos++;
+        afterOpen = false;
+        return false;
+    }
+    if (!afterOpen) {
+        expect(',');
+    }
+    afterOpen = false;
+    return true;
+}
+
+std::string_view JsonReader::readStringView(std::string &decoded) {
+    size_t start = ++pos;
+    while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+        if (static_cast<unsigned char>(text[pos]) < 0x20) {
+            fail("control character in string");
+        }
+        pos++;
+    }
+    if (pos == text.size()) {
+        fail("unterminated string");
+    }
+    if (text[pos] == '"') {
+        return text.substr(start, pos++ - start);
+    }
+
+    decoded.append(text.substr(start, pos - start));
+    while (true) {
+        if (pos == text.size()) {
+            fail("unterminated string");
+        }
+        char c = text[pos++];
+        if (c == '"') {
+            return decoded;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            fail("control character in string");
+        }
+        if (c != '\\') {
+            decoded += c;
+            continue;
+        }
+        if (pos == text.size()) {
+            fail("unterminated string");
+        }
+        switch (text[pos++]) {
+            case '"': decoded += '"'; break;
+            case '\\': decoded += '\\'; break;
+            case '/': decoded += '/'; break;
+            case 'b': decoded += '\b'; break;
+            case 'f': decoded += '\f'; break;
+            case 'n': decoded += '\n'; break;
+            case 'r': decoded += '\r'; break;
+            case 't': decoded += '\t'; break;
+            case 'u': {
+                auto hex4 = [this]() {
+                    uint32_t value = 0;
+                    if (pos + 4 > text.size()) {
+                        fail("short \\u escape");
+                    }
+                    auto [end, ec] = std::from_chars(text.data() + pos, text.data() + pos + 4, value, 16);
+                    if (ec != std::errc() || end != text.data() + pos + 4) {
+                        fail("bad \\u escape");
+                    }
+                    pos += 4;
+                    return value;
+                };
+                uint32_t codepoint = hex4();
+                if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+                    if (text.substr(pos, 2) != "\\u") {
+                        fail("unpaired surrogate");
+                    }
+                    pos += 2;
+                    uint32_t low = hex4();
+                    if (low < 0xDC00 || low >= 0xE000) {
+                        fail("unpaired surrogate");
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codepoint >= 0xDC00 && codepoint < 0xE000) {
+                    fail("unpaired surrogate");
+                }
+                appendUtf8(decoded, codepoint);
+                break;
+            }
+            default:
+                fail("bad escape");
+        }
+    }
+}
+
+std::string JsonReader::readString() {
+    if (next() != '"') {
+        fail("expected a string");
+    }
+    std::string decoded;
+    std::string_view s = readStringView(decoded);
+    return s.data() == decoded.data() ? std::move(decoded) : std::string(s);
+}
+
+std::string_view JsonReader::numberText() {
+    char c = next();
+    if (c != '-' && (c < '0' || c > '9')) {
+        fail("expected a number");
+    }
+    size_t start = pos;
+    while (pos < text.size()) {
+        c = text[pos];
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    return text.substr(start, pos - start);
+}
+
+int64_t JsonReader::readInt() {
+    std::string_view digits = numberText();
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (ec != std::errc() || end != digits.data() + digits.size()) {
+        fail("expected an integer");
+    }
+    return value;
+}
+
+double JsonReader::readDouble() {
+    std::string_view digits = numberText();
+    double value = 0;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (ec != std::errc() || end != digits.data() + digits.size()) {
+        fail("expected a number");
+    }
+    return value;
+}
+
+bool JsonReader::readBool() {
+    if (next() == 't') {
+        expectLiteral("true");
+        return true;
+    }
+    expectLiteral("false");
+    return false;
+}
+
+void JsonReader::readNull() {
+    expectLiteral("null");
+}
+
+std::string_view JsonReader::skipValue() {
+    Kind kind = peek();
+    size_t start = pos;
+    switch (kind) {
+        case Kind::Null:
+            readNull();
+            break;
+        case Kind::Bool:
+            readBool();
+            break;
+        case Kind::Number:
+            numberText();
+            break;
+        case Kind::String:
+            scratch.clear();
+            readStringView(scratch);
+            break;
+        case Kind::Array:
+            beginArray();
+            while (nextElement()) {
+                skipValue();
+            }
+            break;
+        case Kind::Object:
+            beginObject();
+            while (nextKey()) {
+                skipValue();
+            }
+            break;
+    }
+    return text.substr(start, pos - start);
+}
+
+void JsonReader::expectEnd() {
+    skipWhitespace();
+    if (pos != text.size()) {
+        fail("trailing characters");
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef FLYIO_CHALLENGES_JSONREADER_H
+#define FLYIO_CHALLENGES_JSONREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Pull parser over JSON text, for decoding straight into C++ values (see MessageSchema.h) without
+// building a json DOM first. Reads are typed: each call consumes one value of the kind the caller
+// expects, and throws std::runtime_error when the text holds something else or is malformed.
+class JsonReader {
+public:
+    enum class Kind {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    explicit JsonReader(std::string_view text) : text(text) {}
+
+    // Kind of the next value, without consuming it.
+    Kind peek();
+
+    void beginObject();
+    // Next key of the current object, or nullopt once its closing brace is consumed.
+    // The view is valid until the next read.
+    std::optional<std::string_view> nextKey();
+    void beginArray();
+    // Whether the current array has another element; consumes the closing bracket when not.
+    bool nextElement();
+
+    std::string readString();
+    // Throws for fractions, exponents and values out of int64_t's range.
+    int64_t readInt();
+    double readDouble();
+    bool readBool();
+    void readNull();
+    // Skips one value of any kind and returns its text.
+    std::string_view skipValue();
+    // Throws unless only whitespace is left.
+    void expectEnd();
+
+private:
+    std::string_view text;
+    size_t pos = 0;
+    // set by beginObject / beginArray until the first key or element, so no comma is expected before it
+    bool afterOpen = false;
+    // decoded keys that contained escapes
+    std::string scratch;
+
+    void skipWhitespace();
+    char next();
+    void expect(char c);
+    void expectLiteral(std::string_view literal);
+    // Reads a string whose opening quote is next; the view points into the text when nothing was escaped.
+    std::string_view readStringView(std::string &decoded);
+    std::string_view numberText();
+    [[noreturn]] void fail(std::string_view what) const;
+};
+
+#endif //FLYIO_CHALLENGES_JSONREADER_H
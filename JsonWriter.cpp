@@ -0,0 +1,103 @@
+#include "JsonWriter.h"
+
+#include <cmath>
+
+namespace {
+
+bool needsEscape(char c) {
+    return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+}
+
+}
+
+void JsonWriter::writeString(std::string_view s) {
+    out += '"';
+    size_t clean = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (!needsEscape(s[i])) {
+            continue;
+        }
+        out.append(s.data() + clean, i - clean);
+        clean = i + 1;
+        switch (s[i]) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                constexpr char hex[] = "0123456789abcdef";
+                auto c = static_cast<unsigned char>(s[i]);
+                char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+            }
+        }
+    }
+    out.append(s.data() + clean, s.size() - clean);
+    out += '"';
+}
+
+void JsonWriter::value(double d) {
+    separate();
+    needComma = true;
+    if (!std::isfinite(d)) {
+        // as dump() does
+        out += "null";
+        return;
+    }
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), d);
+    std::string_view digits(buf, end - buf);
+    out += digits;
+    // keep it a float when read back
+    if (digits.find_first_of(".e") == std::string_view::npos) {
+        out += ".0";
+    }
+}
+
+void JsonWriter::value(const nlohmann::json &j) {
+    using value_t = nlohmann::json::value_t;
+    switch (j.type()) {
+        case value_t::object:
+            beginObject();
+            for (auto it = j.begin(); it != j.end(); ++it) {
+                key(it.key());
+                value(*it);
+            }
+            endObject();
+            return;
+        case value_t::array:
+            beginArray();
+            for (auto &v : j) {
+                value(v);
+            }
+            endArray();
+            return;
+        case value_t::string:
+            value(std::string_view(j.get_ref<const std::string &>()));
+            return;
+        case value_t::boolean:
+            value(j.get<bool>());
+            return;
+        case value_t::number_integer:
+            value(j.get<nlohmann::json::number_integer_t>());
+            return;
+        case value_t::number_unsigned:
+            value(j.get<nlohmann::json::number_unsigned_t>());
+            return;
+        case value_t::number_float:
+            value(j.get<double>());
+            return;
+        case value_t::binary:
+            // never produced by this code base; leave its encoding to the library
+            separate();
+            out += j.dump();
+            needComma = true;
+            return;
+        default:
+            value(nullptr);
+            return;
+    }
+}
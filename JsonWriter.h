@@ -0,0 +1,115 @@
+#ifndef FLYIO_CHALLENGES_JSONWRITER_H
+#define FLYIO_CHALLENGES_JSONWRITER_H
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "json.hpp"
+
+// Appends JSON text to a string as it is written, with no DOM in between. Separators are placed
+// automatically; the caller keeps the nesting right (a key before each value inside an object).
+// Output is what json::dump() gives for the same values, except that strings are not checked for
+// valid UTF-8 and large or small floats may come out in exponent notation.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string &out) : out(out) {}
+
+    void beginObject() {
+        separate();
+        out += '{';
+        needComma = false;
+    }
+
+    void endObject() {
+        out += '}';
+        needComma = true;
+    }
+
+    void beginArray() {
+        separate();
+        out += '[';
+        needComma = false;
+    }
+
+    void endArray() {
+        out += ']';
+        needComma = true;
+    }
+
+    void key(std::string_view k) {
+        separate();
+        writeString(k);
+        out += ':';
+        needComma = false;
+    }
+
+    void value(std::string_view s) {
+        separate();
+        writeString(s);
+        needComma = true;
+    }
+
+    void value(const char *s) {
+        value(std::string_view(s));
+    }
+
+    void value(const std::string &s) {
+        value(std::string_view(s));
+    }
+
+    void value(bool b) {
+        separate();
+        out += b ? "true" : "false";
+        needComma = true;
+    }
+
+    void value(std::nullptr_t) {
+        separate();
+        out += "null";
+        needComma = true;
+    }
+
+    template<typename T>
+    requires (std::is_integral_v<T> && !std::same_as<T, bool> && !std::same_as<T, char>)
+    void value(T n) {
+        separate();
+        char buf[24];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), n);
+        out.append(buf, end);
+        needComma = true;
+    }
+
+    void value(double d);
+    // Serializes a DOM value in place, without a temporary string.
+    void value(const nlohmann::json &j);
+
+    // Writes text that is already serialized JSON as the next value.
+    void raw(std::string_view serialized) {
+        separate();
+        out += serialized;
+        needComma = true;
+    }
+
+    template<typename T>
+    void field(std::string_view k, const T &v) {
+        key(k);
+        value(v);
+    }
+
+private:
+    std::string &out;
+    bool needComma = false;
+
+    void separate() {
+        if (needComma) {
+            out += ',';
+        }
+    }
+
+    void writeString(std::string_view s);
+};
+
+#endif //FLYIO_CHALLENGES_JSONWRITER_H
@@ -0,0 +1,356 @@
+#include "KafkaLog.h"
+
+#include <charconv>
+#include <stdexcept>
+#include "JsonWriter.h"
+#include "Messages.h"
+
+KafkaLog::Partition &KafkaLog::partition(const string &key) {
+    lock_guard<mutex> lock(partitionsMutex);
+    auto &p = partitions[key];
+    if (!p) {
+        p = make_unique<Partition>();
+    }
+    return *p;
+}
+
+const KafkaLog::Partition *KafkaLog::findPartition(const string &key) const {
+    lock_guard<mutex> lock(partitionsMutex);
+    auto it = partitions.find(key);
+    if (it == partitions.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+void KafkaLog::store(Partition &p, int64_t offset, int64_t msg) {
+    size_t index = offset >> SegmentBits;
+    if (index >= p.segments.size()) {
+        p.segments.resize(index + 1);
+    }
+    auto &segPtr = p.segments[index];
+    if (!segPtr) {
+        segPtr = make_unique<Segment>();
+        segPtr->baseOffset = offset & ~SegmentMask;
+        segPtr->text.reserve(SegmentSize * 16);
+    }
+    Segment &seg = *segPtr;
+    int64_t slot = offset & SegmentMask;
+    uint32_t textEnd = seg.count == 0 ? 0 : seg.textEnd[seg.count - 1];
+    while (seg.count < slot) {
+        seg.textEnd[seg.count++] = textEnd;
+    }
+    char buf[MaxRecordText];
+    char *end = buf;
+    *end++ = '[';
+    auto printed = to_chars(end, buf + sizeof(buf) - 3, offset);
+    if (printed.ec == errc()) {
+        *printed.ptr = ',';
+        printed = to_chars(printed.ptr + 1, buf + sizeof(buf) - 2, msg);
+    }
+    if (printed.ec != errc()) {
+        throw logic_error("log record does not fit MaxRecordText");
+    }
+    end = printed.ptr;
+    *end++ = ']';
+    *end++ = ',';
+    seg.text.append(buf, end);
+    seg.textEnd[slot] = static_cast<uint32_t>(seg.text.size());
+    seg.msgs[slot] = msg;
+    seg.present.set(slot);
+    seg.count = slot + 1;
+    p.nextOffset = offset + 1;
+}
+
+int64_t KafkaLog::append(const string &key, int64_t msg) {
+    Partition &p = partition(key);
+    lock_guard<mutex> lock(p.mtx);
+    int64_t offset = p.nextOffset;
+    store(p, offset, msg);
+    return offset;
+}
+
+int64_t KafkaLog::appendLinKv(Node &node, const string &key, int64_t msg) {
+    Partition &p = partition(key);
+    p.waiting++;
+    // Held across the store so offsets land in the segments in the order they were handed out.
+    {
+        unique_lock<mutex> alloc(p.allocMutex);
+        p.allocFree.wait(*node.scheduler, alloc, [&p]() {
+            return !p.allocating;
+        });
+        p.allocating = true;
+    }
+    p.waiting--;
+    auto release = [&p]() {
+        lock_guard<mutex> alloc(p.allocMutex);
+        p.allocating = false;
+        p.allocFree.notifyOne();
+    };
+    try {
+        if (p.rangeNext == p.rangeEnd) {
+            leaseRange(node, key, p);
+        }
+        int64_t offset = p.rangeNext++;
+        {
+            lock_guard<mutex> lock(p.mtx);
+            store(p, offset, msg);
+        }
+        release();
+        return offset;
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+int64_t KafkaLog::appendOwned(Node &node, const string &key, int64_t msg) {
+    return linKvOffsets ? appendLinKv(node, key, msg) : append(key, msg);
+}
+
+int64_t KafkaLog::appendForwarded(Node &node, const string &origin, const string &key, int64_t msg) {
+    shared_ptr<ForwardedSend> send;
+    bool first = false;
+    {
+        lock_guard<mutex> lock(forwardedMutex);
+        auto [it, inserted] = forwarded.try_emplace(origin);
+        if (inserted) {
+            it->second = make_shared<ForwardedSend>();
+            forwardedOrder.push_back(origin);
+            if (forwardedOrder.size() > MaxRememberedForwards) {
+                forwarded.erase(forwardedOrder.front());
+                forwardedOrder.pop_front();
+            }
+            first = true;
+        }
+        send = it->second;
+    }
+    if (first) {
+        int64_t offset = 0;
+        exception_ptr error;
+        try {
+            offset = appendOwned(node, key, msg);
+        } catch (...) {
+            error = current_exception();
+        }
+        lock_guard<mutex> lock(forwardedMutex);
+        send->offset = offset;
+        send->error = error;
+        send->done = true;
+        forwardedDone.notifyAll();
+    }
+    unique_lock<mutex> lock(forwardedMutex);
+    // a retry waits here while the first copy of its send is still appending
+    forwardedDone.wait(*node.scheduler, lock, [&send]() {
+        return send->done;
+    });
+    if (send->error) {
+        rethrow_exception(send->error);
+    }
+    return send->offset;
+}
+
+void KafkaLog::leaseRange(Node &node, const string &key, Partition &p) {
+    auto now = node.scheduler->now();
+    if (p.rangeEnd > 0) {
+        auto elapsed = now - p.rangeStarted;
+        if (elapsed < LeaseInterval / 2) {
+            p.batchSize = min(p.batchSize * 2, MaxLeaseBatch);
+        } else if (elapsed > LeaseInterval * 2) {
+            p.batchSize = max<int64_t>(p.batchSize / 2, 1);
+        }
+    }
+    p.batchSize = clamp<int64_t>(p.waiting + 1, p.batchSize, MaxLeaseBatch);
+    string kvKey = "offset/" + key;
+    // Our previous lease end is the counter value unless someone else has moved it since.
+    int64_t from = p.rangeEnd;
+    while (true) {
+        json reply = node.retryRPC("lin-kv", {
+                {"type", "cas"},
+                {"key", kvKey},
+                {"from", from},
+                {"to", from + p.batchSize},
+                {"create_if_not_exists", true}
+        });
+        if (reply["type"] == "cas_ok") {
+            break;
+        }
+        if (reply["code"] != 22) {
+            throw runtime_error("lin-kv cas failed: " + reply["text"].get<string>());
+        }
+        reply = node.retryRPC("lin-kv", {{"type", "read"}, {"key", kvKey}});
+        if (reply["type"] == "read_ok") {
+            from = reply["value"];
+        } else if (reply["code"] == 20) {
+            from = 0;
+        } else {
+            throw runtime_error("lin-kv read failed: " + reply["text"].get<string>());
+        }
+    }
+    p.rangeNext = max(from, p.nextOffset);
+    p.rangeEnd = from + p.batchSize;
+    p.rangeStarted = now;
+}
+
+void KafkaLog::pollText(const string &key, int64_t from, size_t limit, string &out) const {
+    out += '[';
+    size_t start = out.size();
+    const Partition *p = findPartition(key);
+    if (p != nullptr) {
+        lock_guard<mutex> lock(p->mtx);
+        int64_t offset = max<int64_t>(from, 0);
+        int64_t end = min(p->nextOffset, offset + static_cast<int64_t>(limit));
+        while (offset < end) {
+            const Segment *seg = p->segments[offset >> SegmentBits].get();
+            int64_t slot = offset & SegmentMask;
+            int64_t last = seg == nullptr ? 0 : min(seg->count, slot + end - offset);
+            if (slot < last) {
+                uint32_t begin = slot == 0 ? 0 : seg->textEnd[slot - 1];
+                out.append(seg->text, begin, seg->textEnd[last - 1] - begin);
+            }
+            offset = ((offset >> SegmentBits) + 1) << SegmentBits;
+        }
+    }
+    if (out.size() > start) {
+        out.back() = ']';
+    } else {
+        out += ']';
+    }
+}
+
+void KafkaLog::commit(const string &key, int64_t offset) {
+    Partition &p = partition(key);
+    lock_guard<mutex> lock(p.mtx);
+    p.committedOffset = max(p.committedOffset, offset);
+}
+
+optional<int64_t> KafkaLog::committed(const string &key) const {
+    const Partition *p = findPartition(key);
+    if (p == nullptr) {
+        return nullopt;
+    }
+    lock_guard<mutex> lock(p->mtx);
+    if (p->committedOffset < 0) {
+        return nullopt;
+    }
+    return p->committedOffset;
+}
+
+const string &KafkaLog::owner(Node &node, const string &key) {
+    if (node.nodeIds.empty()) {
+        return node.nodeId;
+    }
+    call_once(ringOnce, [this, &node]() {
+        ring.build(node.nodeIds);
+    });
+    return ring.owner(key);
+}
+
+json KafkaLog::forward(Node &node, const string &dest, const json &body) {
+    json reply = node.retryRPC(dest, body);
+    if (reply["type"] == "error") {
+        throw runtime_error("forwarding to " + dest + " failed: " + reply["text"].get<string>());
+    }
+    return reply;
+}
+
+void KafkaLog::pollLocal(const map<string, int64_t> &offsets, string &out) const {
+    for (auto& [key, from] : offsets) {
+        if (out.back() != '{') {
+            out += ',';
+        }
+        JsonWriter(out).key(key);
+        pollText(key, from, maxPollRecords, out);
+    }
+}
+
+void KafkaLog::registerHandlers(Node &node) {
+    node.on<Send>([this, &node](const Request<Send>& req) {
+        if (!req.msgId) {
+            throw runtime_error("Cannot reply to a message without a msg_id");
+        }
+        const string &key = req.body.key;
+        const string &dest = owner(node, key);
+        int64_t msg = req.body.msg;
+        int64_t offset;
+        if (dest != node.nodeId) {
+            string origin = req.src + ":" + to_string(*req.msgId);
+            json reply = forward(node, dest, {{"type", "send"}, {"key", key}, {"msg", msg}, {"origin", origin}});
+            offset = reply["offset"];
+        } else if (req.body.origin) {
+            offset = appendForwarded(node, *req.body.origin, key, msg);
+        } else {
+            offset = appendOwned(node, key, msg);
+        }
+        node.reply(req, SendOk{offset});
+    });
+
+    node.on<Poll>([this, &node](const Request<Poll>& req) {
+        if (!req.msgId) {
+            throw runtime_error("Cannot reply to a message without a msg_id");
+        }
+        map<string, map<string, int64_t>> byOwner;
+        for (auto& [key, from] : req.body.offsets) {
+            byOwner[owner(node, key)][key] = from;
+        }
+        // Local records are copied out of the segment arenas as-is; only forwarded results are re-serialized.
+        string body = R"({"type":"poll_ok","in_reply_to":)" + to_string(*req.msgId) + R"(,"msgs":{)";
+        for (auto& [dest, offsets] : byOwner) {
+            if (dest == node.nodeId) {
+                pollLocal(offsets, body);
+                continue;
+            }
+            json msgs = forward(node, dest, {{"type", "poll"}, {"offsets", offsets}})["msgs"];
+            for (auto& [key, records] : msgs.items()) {
+                if (body.back() != '{') {
+                    body += ',';
+                }
+                JsonWriter w(body);
+                w.key(key);
+                w.value(records);
+            }
+        }
+        body += "}}";
+        node.sendRaw(req.src, "poll_ok", body, nullopt, req.msgId);
+    });
+
+    node.on<CommitOffsets>([this, &node](const Request<CommitOffsets>& req) {
+        map<string, map<string, int64_t>> byOwner;
+        for (auto& [key, offset] : req.body.offsets) {
+            byOwner[owner(node, key)][key] = offset;
+        }
+        for (auto& [dest, offsets] : byOwner) {
+            if (dest == node.nodeId) {
+                for (auto& [key, offset] : offsets) {
+                    commit(key, offset);
+                }
+            } else {
+                forward(node, dest, {{"type", "commit_offsets"}, {"offsets", offsets}});
+            }
+        }
+        node.reply(req, CommitOffsetsOk{});
+    });
+
+    node.on<ListCommittedOffsets>([this, &node](const Request<ListCommittedOffsets>& req) {
+        map<string, vector<string>> byOwner;
+        for (auto& key : req.body.keys) {
+            byOwner[owner(node, key)].push_back(key);
+        }
+        ListCommittedOffsetsOk result;
+        for (auto& [dest, keys] : byOwner) {
+            if (dest == node.nodeId) {
+                for (auto& key : keys) {
+                    if (auto offset = committed(key)) {
+                        result.offsets[key] = *offset;
+                    }
+                }
+            } else {
+                json offsets = forward(node, dest, {{"type", "list_committed_offsets"}, {"keys", keys}})["offsets"];
+                for (auto& [key, offset] : offsets.items()) {
+                    result.offsets[key] = offset.get<int64_t>();
+                }
+            }
+        }
+        node.reply(req, result);
+    });
+}
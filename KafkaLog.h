@@ -0,0 +1,153 @@
+#ifndef FLYIO_CHALLENGES_KAFKALOG_H
+#define FLYIO_CHALLENGES_KAFKALOG_H
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <exception>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.h"
+#include "HashRing.h"
+
+// Append-only per-key logs for the send/poll/commit_offsets/list_committed_offsets workload.
+// Each key owns a directory of fixed-size segments; segment i covers offsets
+// [i * SegmentSize, (i + 1) * SegmentSize), so locating an offset is a shift and a mask.
+// In a cluster every key has a single owner on a consistent-hash ring over the init node list;
+// the owner assigns offsets locally and other nodes forward requests for that key to it.
+// With linKvOffsets set, the owner instead leases ranges of offsets from a per-key counter in
+// lin-kv, so offsets stay unique and monotonic even if ownership of a key moves.
+class KafkaLog {
+public:
+    static constexpr int64_t SegmentBits = 10;
+    static constexpr int64_t SegmentSize = int64_t{1} << SegmentBits;
+    static constexpr int64_t SegmentMask = SegmentSize - 1;
+
+    // Room for the longest "[offset,msg]," fragment: two 20-character int64 values and 4 punctuation
+    // characters, with slack so the writes after each to_chars stay in bounds.
+    static constexpr size_t MaxRecordText = 2 * 20 + 4 + 20;
+
+    struct Segment {
+        int64_t baseOffset = 0;
+        // slots [0, count) hold msgs for offsets [baseOffset, baseOffset + count); slots skipped by
+        // an abandoned lin-kv range are clear in `present` and have empty text fragments
+        int64_t count = 0;
+        bitset<SegmentSize> present;
+        array<int64_t, SegmentSize> msgs{};
+        // Pre-rendered "[offset,msg]," fragments laid out back to back in offset order;
+        // slot i occupies text[textEnd[i - 1], textEnd[i]).
+        string text;
+        array<uint32_t, SegmentSize> textEnd{};
+    };
+
+    struct Partition {
+        mutable mutex mtx;
+        vector<unique_ptr<Segment>> segments;
+        int64_t nextOffset = 0;
+        int64_t committedOffset = -1;
+
+        // lin-kv offset lease, used by whichever send holds `allocating`: offsets [rangeNext, rangeEnd) are
+        // ours to hand out
+        int64_t rangeNext = 0;
+        int64_t rangeEnd = 0;
+        int64_t batchSize = 1;
+        Scheduler::Clock::time_point rangeStarted;
+        // guards allocating; the holder may wait on lin-kv, so other sends queue on allocFree, not a mutex
+        mutex allocMutex;
+        bool allocating = false;
+        Scheduler::WaitList allocFree;
+        // sends queued behind the holder; a lease always covers at least these
+        atomic<int64_t> waiting{0};
+    };
+
+    static constexpr int64_t MaxLeaseBatch = 4096;
+    static constexpr size_t MaxRememberedForwards = 65536;
+    // A lease should last about this long; faster senders get bigger batches.
+    static constexpr chrono::milliseconds LeaseInterval{200};
+
+    size_t maxPollRecords = 1024;
+    bool linKvOffsets = false;
+
+    int64_t append(const string &key, int64_t msg);
+    int64_t appendLinKv(Node &node, const string &key, int64_t msg);
+    // Calls visit(baseOffset, msgs, count) for each contiguous run starting at `from`,
+    // scanning at most `limit` offsets.
+    template<typename Visit>
+    void poll(const string &key, int64_t from, size_t limit, Visit &&visit) const;
+    // Appends the JSON array of records in [from, from + limit) to `out`.
+    void pollText(const string &key, int64_t from, size_t limit, string &out) const;
+    void commit(const string &key, int64_t offset);
+    [[nodiscard]] optional<int64_t> committed(const string &key) const;
+    void registerHandlers(Node &node);
+
+private:
+    mutable mutex partitionsMutex;
+    unordered_map<string, unique_ptr<Partition>> partitions;
+    HashRing ring;
+    once_flag ringOnce;
+    // The outcome of a forwarded send, once its first copy has appended it.
+    struct ForwardedSend {
+        bool done = false;
+        int64_t offset = 0;
+        exception_ptr error;
+    };
+
+    // Forwarded sends are retried when they time out, so the owner remembers the offset handed to each
+    // recent one (keyed by the client request it came from) and answers a retry with the same offset.
+    // forwardedMutex guards the map, the order and every ForwardedSend; retries wait on forwardedDone.
+    mutex forwardedMutex;
+    unordered_map<string, shared_ptr<ForwardedSend>> forwarded;
+    deque<string> forwardedOrder;
+    Scheduler::WaitList forwardedDone;
+
+    const string &owner(Node &node, const string &key);
+    json forward(Node &node, const string &dest, const json &body);
+    void pollLocal(const map<string, int64_t> &offsets, string &out) const;
+
+    void leaseRange(Node &node, const string &key, Partition &p);
+    int64_t appendOwned(Node &node, const string &key, int64_t msg);
+    int64_t appendForwarded(Node &node, const string &origin, const string &key, int64_t msg);
+
+    Partition &partition(const string &key);
+    static void store(Partition &p, int64_t offset, int64_t msg);
+    [[nodiscard]] const Partition *findPartition(const string &key) const;
+};
+
+template<typename Visit>
+void KafkaLog::poll(const string &key, int64_t from, size_t limit, Visit &&visit) const {
+    const Partition *p = findPartition(key);
+    if (p == nullptr) {
+        return;
+    }
+    lock_guard<mutex> lock(p->mtx);
+    int64_t offset = max<int64_t>(from, 0);
+    int64_t end = min(p->nextOffset, offset + static_cast<int64_t>(limit));
+    while (offset < end) {
+        const Segment *seg = p->segments[offset >> SegmentBits].get();
+        int64_t slot = offset & SegmentMask;
+        int64_t last = seg == nullptr ? 0 : min(seg->count, slot + end - offset);
+        while (slot < last) {
+            if (!seg->present[slot]) {
+                slot++;
+                continue;
+            }
+            int64_t run = slot;
+            while (run < last && seg->present[run]) {
+                run++;
+            }
+            visit(seg->baseOffset + slot, seg->msgs.data() + slot, run - slot);
+            slot = run;
+        }
+        offset = ((offset >> SegmentBits) + 1) << SegmentBits;
+    }
+}
+
+#endif //FLYIO_CHALLENGES_KAFKALOG_H
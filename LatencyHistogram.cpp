@@ -0,0 +1,63 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+    micros = std::min(micros, (uint64_t{1} << (MaxExponent + 1)) - 1);
+    if (micros < SubBuckets) {
+        return micros;
+    }
+    int exponent = std::bit_width(micros) - 1;
+    uint64_t sub = (micros >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+    return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t bucket) {
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+    int exponent = static_cast<int>(bucket / SubBuckets) + SubBucketBits - 1;
+    uint64_t sub = bucket % SubBuckets;
+    return ((SubBuckets + sub + 1) << (exponent - SubBucketBits)) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds elapsed) {
+    auto micros = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    Shard &s = shards.local();
+    s.counts[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = s.max.load(std::memory_order_relaxed);
+    while (micros > seen && !s.max.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    snap.counts.assign(Buckets, 0);
+    shards.forEach([&snap](const Shard &s) {
+        for (size_t b = 0; b < Buckets; b++) {
+            uint64_t n = s.counts[b].load(std::memory_order_relaxed);
+            snap.counts[b] += n;
+            snap.count += n;
+        }
+        snap.max = std::max(snap.max, s.max.load(std::memory_order_relaxed));
+    });
+    return snap;
+}
+
+uint64_t LatencyHistogram::Snapshot::valueAt(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+    rank = std::clamp<uint64_t>(rank, 1, count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return std::min(bucketValue(b), max);
+        }
+    }
+    return max;
+}
@@ -0,0 +1,47 @@
+#ifndef FLYIO_CHALLENGES_LATENCYHISTOGRAM_H
+#define FLYIO_CHALLENGES_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "ThreadShard.h"
+
+// HDR-style latency histogram in microseconds: exact below 16us, then 16 buckets per power of two, so
+// any recorded value is reported within 1/16 (6.25%) of itself, up to about 19 hours.
+// record() is a relaxed increment on the calling thread's shard.
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr size_t SubBuckets = size_t{1} << SubBucketBits;
+    static constexpr int MaxExponent = 35;
+    static constexpr size_t Buckets = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t max = 0;
+
+        // Smallest bucket value that at least fraction q of the recorded values are at or below.
+        [[nodiscard]] uint64_t valueAt(double q) const;
+    };
+
+    void record(std::chrono::nanoseconds elapsed);
+    // Sums every shard; concurrent records may or may not be included.
+    [[nodiscard]] Snapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t micros);
+    // The highest value that lands in a bucket.
+    static uint64_t bucketValue(size_t bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, Buckets> counts{};
+        std::atomic<uint64_t> max{0};
+    };
+
+    Sharded<Shard> shards;
+};
+
+#endif //FLYIO_CHALLENGES_LATENCYHISTOGRAM_H
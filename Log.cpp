@@ -0,0 +1,177 @@
+#include "Log.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr std::array<std::string_view, 5> LevelNames{"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+// Bounded multi-producer queue (Vyukov): each slot's sequence number says whether it is free for the
+// producer at that position or holds a line for the consumer, so neither side takes a lock.
+class LogRing {
+public:
+    static constexpr size_t Capacity = 4096;
+
+    LogRing() {
+        for (size_t i = 0; i < Capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(LogLevel level, std::string &&line) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = slots[pos % Capacity];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.level = level;
+                    slot.line = std::move(line);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer.
+    bool pop(LogLevel &level, std::string &line) {
+        Slot &slot = slots[head % Capacity];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        level = slot.level;
+        line = std::move(slot.line);
+        slot.line.clear();
+        slot.sequence.store(head + Capacity, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+    // Lines popped so far; consumer only.
+    [[nodiscard]] size_t popped() const {
+        return head;
+    }
+
+    [[nodiscard]] size_t claimed() const {
+        return tail.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level = LogLevel::Info;
+        std::string line;
+    };
+
+    std::array<Slot, Capacity> slots;
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) size_t head = 0;
+};
+
+LogRing &ring() {
+    static auto *r = new LogRing;
+    return *r;
+}
+
+std::atomic<uint64_t> droppedLines{0};
+// lines popped from the ring and written to stderr, for flush()
+std::atomic<size_t> writtenLines{0};
+
+void drainLoop() {
+    LogRing &r = ring();
+    std::string batch;
+    std::string line;
+    LogLevel level;
+    uint64_t reportedDrops = 0;
+    auto idle = std::chrono::microseconds(100);
+    while (true) {
+        batch.clear();
+        while (batch.size() < 64 * 1024 && r.pop(level, line)) {
+            batch += LevelNames[static_cast<size_t>(level)];
+            batch += ' ';
+            batch += line;
+            batch += '\n';
+        }
+        uint64_t drops = droppedLines.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            batch += "WARN dropped " + std::to_string(drops - reportedDrops) + " log lines, the log ring was full\n";
+            reportedDrops = drops;
+        }
+        if (!batch.empty()) {
+            fwrite(batch.data(), 1, batch.size(), stderr);
+            fflush(stderr);
+            writtenLines.store(r.popped(), std::memory_order_release);
+            idle = std::chrono::microseconds(100);
+            continue;
+        }
+        // back off while there is nothing to write
+        std::this_thread::sleep_for(idle);
+        idle = std::min(idle * 2, std::chrono::microseconds(10000));
+    }
+}
+
+int initialLevel() {
+    const char *name = getenv("FLYIO_LOG_LEVEL");
+    if (name == nullptr) {
+        return static_cast<int>(LogLevel::Info);
+    }
+    try {
+        return static_cast<int>(Log::levelNamed(name));
+    } catch (std::invalid_argument &) {
+        return static_cast<int>(LogLevel::Info);
+    }
+}
+
+}
+
+std::atomic<int> Log::threshold{initialLevel()};
+
+void Log::setLevel(LogLevel level) {
+    threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Log::levelNamed(std::string_view name) {
+    static constexpr std::array<std::pair<std::string_view, LogLevel>, 6> levels{{
+            {"trace", LogLevel::Trace}, {"debug", LogLevel::Debug}, {"info", LogLevel::Info},
+            {"warn", LogLevel::Warn}, {"error", LogLevel::Error}, {"off", LogLevel::Off}
+    }};
+    for (auto &[n, level] : levels) {
+        if (n == name) {
+            return level;
+        }
+    }
+    throw std::invalid_argument("unknown log level " + std::string(name));
+}
+
+void Log::submit(LogLevel level, std::string &&line) {
+    static std::once_flag started;
+    std::call_once(started, []() {
+        std::thread(drainLoop).detach();
+    });
+    if (!ring().push(level, std::move(line))) {
+        droppedLines.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Log::flush() {
+    size_t target = ring().claimed();
+    while (writtenLines.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+uint64_t Log::dropped() {
+    return droppedLines.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,101 @@
+#ifndef FLYIO_CHALLENGES_LOG_H
+#define FLYIO_CHALLENGES_LOG_H
+
+#include <atomic>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "json.hpp"
+
+enum class LogLevel : int {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// Levels below FLYIO_LOG_MIN_LEVEL are compiled out: their arguments are never evaluated. Release
+// builds keep Info and up unless the build says otherwise (cmake -DFLYIO_LOG_MIN_LEVEL=0 for all).
+#ifndef FLYIO_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define FLYIO_LOG_MIN_LEVEL 2
+#else
+#define FLYIO_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Leveled logger for the node. A log call formats its line on the calling thread and hands it to a
+// fixed-size lock-free ring; a background thread drains the ring to stderr in batches, so handlers
+// never wait on stderr. When the ring is full, lines are dropped and counted rather than blocking.
+// The runtime level starts from FLYIO_LOG_LEVEL (trace, debug, info, warn, error, off; default info).
+class Log {
+public:
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= threshold.load(std::memory_order_relaxed);
+    }
+
+    static void setLevel(LogLevel level);
+    // Throws std::invalid_argument for unknown names.
+    static LogLevel levelNamed(std::string_view name);
+
+    template<typename... Args>
+    static void write(LogLevel level, const Args &... args) {
+        std::string line;
+        (append(line, args), ...);
+        submit(level, std::move(line));
+    }
+
+    // Blocks until every line logged before the call has been written.
+    static void flush();
+    [[nodiscard]] static uint64_t dropped();
+
+    static void append(std::string &out, std::string_view s) {
+        out += s;
+    }
+
+    static void append(std::string &out, char c) {
+        out += c;
+    }
+
+    template<typename T>
+    requires (std::is_arithmetic_v<T> && !std::same_as<T, char> && !std::same_as<T, bool>)
+    static void append(std::string &out, T value) {
+        char buf[32];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, end);
+    }
+
+    template<typename T>
+    requires std::same_as<T, nlohmann::json>
+    static void append(std::string &out, const T &value) {
+        out += value.dump();
+    }
+
+private:
+    static std::atomic<int> threshold;
+
+    static void submit(LogLevel level, std::string &&line);
+};
+
+#define FLYIO_LOG(level, ...)                                                            \
+    do {                                                                                 \
+        if constexpr (static_cast<int>(level) >= FLYIO_LOG_MIN_LEVEL) {                  \
+            if (Log::enabled(level)) {                                                   \
+                Log::write(level, __VA_ARGS__);                                          \
+            }                                                                            \
+        }                                                                                \
+    } while (0)
+
+#define LOG_TRACE(...) FLYIO_LOG(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) FLYIO_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) FLYIO_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) FLYIO_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) FLYIO_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif //FLYIO_CHALLENGES_LOG_H
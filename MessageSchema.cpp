@@ -0,0 +1,62 @@
+#include "MessageSchema.h"
+
+namespace schema {
+
+void decode(JsonReader &r, std::string &out) {
+    out = r.readString();
+}
+
+void decode(JsonReader &r, bool &out) {
+    out = r.readBool();
+}
+
+void decode(JsonReader &r, double &out) {
+    out = r.readDouble();
+}
+
+void decode(JsonReader &r, nlohmann::json &out) {
+    out = nlohmann::json::parse(r.skipValue());
+}
+
+void decode(const nlohmann::json &j, std::string &out) {
+    if (!j.is_string()) {
+        throw std::runtime_error("expected a string, got " + j.dump());
+    }
+    out = j.get_ref<const std::string &>();
+}
+
+void decode(const nlohmann::json &j, bool &out) {
+    if (!j.is_boolean()) {
+        throw std::runtime_error("expected a bool, got " + j.dump());
+    }
+    out = j.get<bool>();
+}
+
+void decode(const nlohmann::json &j, double &out) {
+    if (!j.is_number()) {
+        throw std::runtime_error("expected a number, got " + j.dump());
+    }
+    out = j.get<double>();
+}
+
+void decode(const nlohmann::json &j, nlohmann::json &out) {
+    out = j;
+}
+
+void encode(JsonWriter &w, const std::string &v) {
+    w.value(std::string_view(v));
+}
+
+void encode(JsonWriter &w, bool v) {
+    w.value(v);
+}
+
+void encode(JsonWriter &w, double v) {
+    w.value(v);
+}
+
+void encode(JsonWriter &w, const nlohmann::json &v) {
+    w.value(v);
+}
+
+}
@@ -0,0 +1,416 @@
+#ifndef FLYIO_CHALLENGES_MESSAGESCHEMA_H
+#define FLYIO_CHALLENGES_MESSAGESCHEMA_H
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "JsonReader.h"
+#include "JsonWriter.h"
+#include "json.hpp"
+
+// Typed message bodies. A message struct names its Maelstrom type and lists its fields in a constexpr
+// table; the templates here generate from that table a decoder from raw JSON text, a decoder from a
+// json DOM (for the simulator, which passes messages around parsed) and a writer:
+//
+//   struct Broadcast {
+//       static constexpr std::string_view type = "broadcast";
+//       std::string message;
+//       static constexpr auto fields = std::tuple{schema::field("message", &Broadcast::message)};
+//   };
+//
+// Fields may be strings, integers, doubles, bools, nlohmann::json, or optionals, vectors, sets, tuples
+// (fixed-size arrays) and string-keyed maps of those. Optional fields may be absent; any other missing
+// field is an error. Unknown fields are skipped. "type", "msg_id" and "in_reply_to" belong to the
+// envelope (see Node::on<T>) and cannot be fields. Mistakes in a table fail to compile.
+namespace schema {
+
+template<typename T, typename M>
+struct Field {
+    std::string_view name;
+    M T::*member;
+};
+
+template<typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::*member) {
+    return {name, member};
+}
+
+template<typename T>
+concept Message = requires {
+    { T::type } -> std::convertible_to<std::string_view>;
+    T::fields;
+};
+
+template<typename M>
+struct IsOptional : std::false_type {};
+
+template<typename M>
+struct IsOptional<std::optional<M>> : std::true_type {};
+
+// Value codecs, one overload per supported type. All declared before any is defined, so containers
+// of containers find each other.
+
+void decode(JsonReader &r, std::string &out);
+void decode(JsonReader &r, bool &out);
+void decode(JsonReader &r, double &out);
+void decode(JsonReader &r, nlohmann::json &out);
+template<std::integral I> requires (!std::same_as<I, bool>)
+void decode(JsonReader &r, I &out);
+template<typename M>
+void decode(JsonReader &r, std::optional<M> &out);
+template<typename M>
+void decode(JsonReader &r, std::vector<M> &out);
+template<typename M>
+void decode(JsonReader &r, std::set<M> &out);
+template<typename M>
+void decode(JsonReader &r, std::map<std::string, M> &out);
+template<typename... Ms>
+void decode(JsonReader &r, std::tuple<Ms...> &out);
+
+void decode(const nlohmann::json &j, std::string &out);
+void decode(const nlohmann::json &j, bool &out);
+void decode(const nlohmann::json &j, double &out);
+void decode(const nlohmann::json &j, nlohmann::json &out);
+template<std::integral I> requires (!std::same_as<I, bool>)
+void decode(const nlohmann::json &j, I &out);
+template<typename M>
+void decode(const nlohmann::json &j, std::optional<M> &out);
+template<typename M>
+void decode(const nlohmann::json &j, std::vector<M> &out);
+template<typename M>
+void decode(const nlohmann::json &j, std::set<M> &out);
+template<typename M>
+void decode(const nlohmann::json &j, std::map<std::string, M> &out);
+template<typename... Ms>
+void decode(const nlohmann::json &j, std::tuple<Ms...> &out);
+
+void encode(JsonWriter &w, const std::string &v);
+void encode(JsonWriter &w, bool v);
+void encode(JsonWriter &w, double v);
+void encode(JsonWriter &w, const nlohmann::json &v);
+template<std::integral I> requires (!std::same_as<I, bool>)
+void encode(JsonWriter &w, I v);
+template<typename M>
+void encode(JsonWriter &w, const std::optional<M> &v);
+template<typename M>
+void encode(JsonWriter &w, const std::vector<M> &v);
+template<typename M>
+void encode(JsonWriter &w, const std::set<M> &v);
+template<typename M>
+void encode(JsonWriter &w, const std::map<std::string, M> &v);
+template<typename... Ms>
+void encode(JsonWriter &w, const std::tuple<Ms...> &v);
+
+template<typename M>
+concept Codable = requires(JsonReader &r, const nlohmann::json &j, JsonWriter &w, M &m) {
+    decode(r, m);
+    decode(j, m);
+    encode(w, std::as_const(m));
+};
+
+template<std::integral I> requires (!std::same_as<I, bool>)
+void decode(JsonReader &r, I &out) {
+    int64_t v = r.readInt();
+    if (!std::in_range<I>(v)) {
+        throw std::runtime_error("integer out of range: " + std::to_string(v));
+    }
+    out = static_cast<I>(v);
+}
+
+template<typename M>
+void decode(JsonReader &r, std::optional<M> &out) {
+    if (r.peek() == JsonReader::Kind::Null) {
+        r.readNull();
+        out.reset();
+        return;
+    }
+    decode(r, out.emplace());
+}
+
+template<typename M>
+void decode(JsonReader &r, std::vector<M> &out) {
+    out.clear();
+    r.beginArray();
+    while (r.nextElement()) {
+        decode(r, out.emplace_back());
+    }
+}
+
+template<typename M>
+void decode(JsonReader &r, std::set<M> &out) {
+    out.clear();
+    r.beginArray();
+    while (r.nextElement()) {
+        M v;
+        decode(r, v);
+        out.insert(std::move(v));
+    }
+}
+
+template<typename M>
+void decode(JsonReader &r, std::map<std::string, M> &out) {
+    out.clear();
+    r.beginObject();
+    while (auto key = r.nextKey()) {
+        // the key's view only lasts until the value is read
+        decode(r, out[std::string(*key)]);
+    }
+}
+
+template<typename... Ms>
+void decode(JsonReader &r, std::tuple<Ms...> &out) {
+    r.beginArray();
+    std::apply([&r](auto &... element) {
+        ((r.nextElement() ? decode(r, element) : throw std::runtime_error("array too short")), ...);
+    }, out);
+    if (r.nextElement()) {
+        throw std::runtime_error("array too long");
+    }
+}
+
+template<std::integral I> requires (!std::same_as<I, bool>)
+void decode(const nlohmann::json &j, I &out) {
+    if (!j.is_number_integer()) {
+        throw std::runtime_error("expected an integer, got " + j.dump());
+    }
+    int64_t v = j.get<int64_t>();
+    if (!std::in_range<I>(v)) {
+        throw std::runtime_error("integer out of range: " + std::to_string(v));
+    }
+    out = static_cast<I>(v);
+}
+
+template<typename M>
+void decode(const nlohmann::json &j, std::optional<M> &out) {
+    if (j.is_null()) {
+        out.reset();
+        return;
+    }
+    decode(j, out.emplace());
+}
+
+template<typename M>
+void decode(const nlohmann::json &j, std::vector<M> &out) {
+    if (!j.is_array()) {
+        throw std::runtime_error("expected an array, got " + j.dump());
+    }
+    out.clear();
+    out.reserve(j.size());
+    for (auto &element : j) {
+        decode(element, out.emplace_back());
+    }
+}
+
+template<typename M>
+void decode(const nlohmann::json &j, std::set<M> &out) {
+    if (!j.is_array()) {
+        throw std::runtime_error("expected an array, got " + j.dump());
+    }
+    out.clear();
+    for (auto &element : j) {
+        M v;
+        decode(element, v);
+        out.insert(std::move(v));
+    }
+}
+
+template<typename M>
+void decode(const nlohmann::json &j, std::map<std::string, M> &out) {
+    if (!j.is_object()) {
+        throw std::runtime_error("expected an object, got " + j.dump());
+    }
+    out.clear();
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        decode(*it, out[it.key()]);
+    }
+}
+
+template<typename... Ms>
+void decode(const nlohmann::json &j, std::tuple<Ms...> &out) {
+    if (!j.is_array() || j.size() != sizeof...(Ms)) {
+        throw std::runtime_error("expected an array of " + std::to_string(sizeof...(Ms)) + ", got " + j.dump());
+    }
+    size_t i = 0;
+    std::apply([&j, &i](auto &... element) {
+        (decode(j[i++], element), ...);
+    }, out);
+}
+
+template<std::integral I> requires (!std::same_as<I, bool>)
+void encode(JsonWriter &w, I v) {
+    w.value(v);
+}
+
+template<typename M>
+void encode(JsonWriter &w, const std::optional<M> &v) {
+    if (v) {
+        encode(w, *v);
+    } else {
+        w.value(nullptr);
+    }
+}
+
+template<typename M>
+void encode(JsonWriter &w, const std::vector<M> &v) {
+    w.beginArray();
+    for (auto &element : v) {
+        encode(w, element);
+    }
+    w.endArray();
+}
+
+template<typename M>
+void encode(JsonWriter &w, const std::set<M> &v) {
+    w.beginArray();
+    for (auto &element : v) {
+        encode(w, element);
+    }
+    w.endArray();
+}
+
+template<typename M>
+void encode(JsonWriter &w, const std::map<std::string, M> &v) {
+    w.beginObject();
+    for (auto &[key, element] : v) {
+        w.key(key);
+        encode(w, element);
+    }
+    w.endObject();
+}
+
+template<typename... Ms>
+void encode(JsonWriter &w, const std::tuple<Ms...> &v) {
+    w.beginArray();
+    std::apply([&w](auto &... element) {
+        (encode(w, element), ...);
+    }, v);
+    w.endArray();
+}
+
+// The checks behind "mistakes in a table fail to compile".
+template<Message T>
+consteval bool validSchema() {
+    constexpr size_t n = std::tuple_size_v<std::remove_cvref_t<decltype(T::fields)>>;
+    static_assert(n <= 64, "too many fields to track which were seen");
+    return std::apply([](auto... f) {
+        if constexpr (n == 0) {
+            return true;
+        } else {
+            std::string_view names[] = {f.name...};
+            for (size_t i = 0; i < n; i++) {
+                if (names[i].empty() || names[i] == "type" || names[i] == "msg_id" || names[i] == "in_reply_to") {
+                    return false;
+                }
+                for (size_t k = 0; k < i; k++) {
+                    if (names[k] == names[i]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    }, T::fields);
+}
+
+template<Message T>
+constexpr bool allCodable() {
+    return std::apply([](auto... f) {
+        return (Codable<std::remove_cvref_t<decltype(std::declval<T &>().*(f.member))>> && ...);
+    }, T::fields);
+}
+
+template<Message T>
+void checkSchema() {
+    static_assert(validSchema<T>(), "message field names must be unique, non-empty and not envelope fields");
+    static_assert(allCodable<T>(), "message field of a type the schema cannot encode");
+}
+
+template<Message T>
+[[noreturn]] void missingField(std::string_view name) {
+    throw std::runtime_error(std::string(T::type) + ": missing field " + std::string(name));
+}
+
+// Decodes a message body straight from its JSON text; the envelope fields are left to the caller.
+template<Message T>
+T parse(std::string_view body) {
+    checkSchema<T>();
+    T msg{};
+    uint64_t seen = 0;
+    JsonReader r(body);
+    r.beginObject();
+    while (auto key = r.nextKey()) {
+        bool matched = false;
+        size_t i = 0;
+        std::apply([&](auto &... f) {
+            ((!matched && f.name == *key ? (decode(r, msg.*(f.member)), seen |= uint64_t{1} << i, matched = true) : false,
+              i++), ...);
+        }, T::fields);
+        if (!matched) {
+            r.skipValue();
+        }
+    }
+    r.expectEnd();
+    size_t i = 0;
+    std::apply([&](auto &... f) {
+        ((IsOptional<std::remove_cvref_t<decltype(msg.*(f.member))>>::value || (seen >> i & 1) ? void() : missingField<T>(f.name),
+          i++), ...);
+    }, T::fields);
+    return msg;
+}
+
+template<Message T>
+T fromJson(const nlohmann::json &body) {
+    checkSchema<T>();
+    T msg{};
+    std::apply([&](auto &... f) {
+        ([&] {
+            auto it = body.find(f.name);
+            if (it != body.end()) {
+                decode(*it, msg.*(f.member));
+            } else if (!IsOptional<std::remove_cvref_t<decltype(msg.*(f.member))>>::value) {
+                missingField<T>(f.name);
+            }
+        }(), ...);
+    }, T::fields);
+    return msg;
+}
+
+// Writes a whole body: its type, the fields (unset optionals left out), then the ids that are given.
+template<Message T>
+void write(JsonWriter &w, const T &msg, std::optional<int64_t> msgId, std::optional<int64_t> inReplyTo) {
+    checkSchema<T>();
+    w.beginObject();
+    w.field("type", std::string_view(T::type));
+    std::apply([&](auto &... f) {
+        ([&] {
+            auto &v = msg.*(f.member);
+            if constexpr (IsOptional<std::remove_cvref_t<decltype(v)>>::value) {
+                if (!v) {
+                    return;
+                }
+            }
+            w.key(f.name);
+            encode(w, v);
+        }(), ...);
+    }, T::fields);
+    if (msgId) {
+        w.field("msg_id", *msgId);
+    }
+    if (inReplyTo) {
+        w.field("in_reply_to", *inReplyTo);
+    }
+    w.endObject();
+}
+
+}
+
+#endif //FLYIO_CHALLENGES_MESSAGESCHEMA_H
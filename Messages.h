@@ -0,0 +1,111 @@
+#ifndef FLYIO_CHALLENGES_MESSAGES_H
+#define FLYIO_CHALLENGES_MESSAGES_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "MessageSchema.h"
+
+// Bodies of the Maelstrom workload messages the node serves, and of their replies (see MessageSchema.h).
+
+struct Broadcast {
+    static constexpr std::string_view type = "broadcast";
+    int64_t message = 0;
+    static constexpr auto fields = std::tuple{schema::field("message", &Broadcast::message)};
+};
+
+struct BroadcastOk {
+    static constexpr std::string_view type = "broadcast_ok";
+    static constexpr auto fields = std::tuple{};
+};
+
+struct Read {
+    static constexpr std::string_view type = "read";
+    static constexpr auto fields = std::tuple{};
+};
+
+// The read handler writes this body straight from the node's message set rather than filling one in.
+struct ReadOk {
+    static constexpr std::string_view type = "read_ok";
+    std::set<int64_t> messages;
+    static constexpr auto fields = std::tuple{schema::field("messages", &ReadOk::messages)};
+};
+
+struct Topology {
+    static constexpr std::string_view type = "topology";
+    std::map<std::string, std::vector<std::string>> topology;
+    static constexpr auto fields = std::tuple{schema::field("topology", &Topology::topology)};
+};
+
+struct TopologyOk {
+    static constexpr std::string_view type = "topology_ok";
+    static constexpr auto fields = std::tuple{};
+};
+
+// Also forwarded between nodes to a key's owner, with origin naming the client request it came from.
+struct Send {
+    static constexpr std::string_view type = "send";
+    std::string key;
+    int64_t msg = 0;
+    std::optional<std::string> origin;
+    static constexpr auto fields = std::tuple{schema::field("key", &Send::key), schema::field("msg", &Send::msg),
+                                              schema::field("origin", &Send::origin)};
+};
+
+struct SendOk {
+    static constexpr std::string_view type = "send_ok";
+    int64_t offset = 0;
+    static constexpr auto fields = std::tuple{schema::field("offset", &SendOk::offset)};
+};
+
+// Answered with a pre-rendered poll_ok (see KafkaLog).
+struct Poll {
+    static constexpr std::string_view type = "poll";
+    std::map<std::string, int64_t> offsets;
+    static constexpr auto fields = std::tuple{schema::field("offsets", &Poll::offsets)};
+};
+
+struct CommitOffsets {
+    static constexpr std::string_view type = "commit_offsets";
+    std::map<std::string, int64_t> offsets;
+    static constexpr auto fields = std::tuple{schema::field("offsets", &CommitOffsets::offsets)};
+};
+
+struct CommitOffsetsOk {
+    static constexpr std::string_view type = "commit_offsets_ok";
+    static constexpr auto fields = std::tuple{};
+};
+
+struct ListCommittedOffsets {
+    static constexpr std::string_view type = "list_committed_offsets";
+    std::vector<std::string> keys;
+    static constexpr auto fields = std::tuple{schema::field("keys", &ListCommittedOffsets::keys)};
+};
+
+struct ListCommittedOffsetsOk {
+    static constexpr std::string_view type = "list_committed_offsets_ok";
+    std::map<std::string, int64_t> offsets;
+    static constexpr auto fields = std::tuple{schema::field("offsets", &ListCommittedOffsetsOk::offsets)};
+};
+
+// ["r", key, null] or ["w", key, value]
+using TxnOp = std::tuple<std::string, int64_t, std::optional<int64_t>>;
+
+struct Txn {
+    static constexpr std::string_view type = "txn";
+    std::vector<TxnOp> txn;
+    static constexpr auto fields = std::tuple{schema::field("txn", &Txn::txn)};
+};
+
+struct TxnOk {
+    static constexpr std::string_view type = "txn_ok";
+    std::vector<TxnOp> txn;
+    static constexpr auto fields = std::tuple{schema::field("txn", &TxnOk::txn)};
+};
+
+#endif //FLYIO_CHALLENGES_MESSAGES_H
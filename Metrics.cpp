@@ -0,0 +1,96 @@
+#include "Metrics.h"
+
+#include <functional>
+
+size_t Metrics::KeyTable::indexOf(std::string_view key) {
+    size_t start = std::hash<std::string_view>{}(key) % Slots;
+    for (size_t probe = 0; probe < Slots; probe++) {
+        const Key *k = slots[(start + probe) % Slots].load(std::memory_order_acquire);
+        if (k == nullptr) {
+            break;
+        }
+        if (k->name == key) {
+            return k->index;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    size_t probe = 0;
+    for (; probe < Slots; probe++) {
+        const Key *k = slots[(start + probe) % Slots].load(std::memory_order_relaxed);
+        if (k == nullptr) {
+            break;
+        }
+        if (k->name == key) {
+            return k->index;
+        }
+    }
+    size_t index = indexNames.size();
+    if (index == MaxKeys - 1) {
+        indexNames.emplace_back("other");
+    } else if (index == MaxKeys) {
+        index = MaxKeys - 1;
+    } else {
+        indexNames.emplace_back(key);
+    }
+    // half full at most, so probes stay short; past that, keys beyond MaxKeys take the mutex every time
+    if (probe < Slots && keys.size() < Slots / 2) {
+        keys.push_back({std::string(key), index});
+        slots[(start + probe) % Slots].store(&keys.back(), std::memory_order_release);
+    }
+    return index;
+}
+
+std::deque<std::string> Metrics::KeyTable::names() const {
+    std::lock_guard<std::mutex> lock(m);
+    return indexNames;
+}
+
+void Metrics::add(Counter c, uint64_t n) {
+    shards.local().counters[static_cast<size_t>(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics::received(std::string_view type, std::string_view peer, size_t bytes) {
+    size_t t = types.indexOf(type);
+    size_t p = peers.indexOf(peer);
+    Shard &s = shards.local();
+    s.typeIn[t].fetch_add(1, std::memory_order_relaxed);
+    s.peerIn[p].fetch_add(1, std::memory_order_relaxed);
+    s.counters[static_cast<size_t>(Counter::BytesIn)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::sent(std::string_view type, std::string_view peer, size_t bytes) {
+    size_t t = types.indexOf(type);
+    size_t p = peers.indexOf(peer);
+    Shard &s = shards.local();
+    s.typeOut[t].fetch_add(1, std::memory_order_relaxed);
+    s.peerOut[p].fetch_add(1, std::memory_order_relaxed);
+    s.counters[static_cast<size_t>(Counter::BytesOut)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+Metrics::Snapshot Metrics::snapshot() const {
+    std::deque<std::string> typeNames = types.names();
+    std::deque<std::string> peerNames = peers.names();
+    Snapshot snap;
+    shards.forEach([&](const Shard &s) {
+        for (size_t c = 0; c < snap.counters.size(); c++) {
+            snap.counters[c] += s.counters[c].load(std::memory_order_relaxed);
+        }
+        // a key interned after names() were read may already have counts; it shows up next time
+        for (size_t i = 0; i < typeNames.size(); i++) {
+            InOut &entry = snap.byType[typeNames[i]];
+            entry.in += s.typeIn[i].load(std::memory_order_relaxed);
+            entry.out += s.typeOut[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < peerNames.size(); i++) {
+            InOut &entry = snap.byPeer[peerNames[i]];
+            entry.in += s.peerIn[i].load(std::memory_order_relaxed);
+            entry.out += s.peerOut[i].load(std::memory_order_relaxed);
+        }
+    });
+    for (auto &[type, counts] : snap.byType) {
+        snap.messagesIn += counts.in;
+        snap.messagesOut += counts.out;
+    }
+    return snap;
+}
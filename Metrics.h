@@ -0,0 +1,92 @@
+#ifndef FLYIO_CHALLENGES_METRICS_H
+#define FLYIO_CHALLENGES_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "ThreadShard.h"
+
+// Network and RPC counters for a Node: messages in and out per message type and per peer, bytes in and
+// out, RPC retries, timeouts, and replies that arrived after nobody was waiting for them.
+// Counting is a relaxed increment on the calling thread's shard; keys (types, peers) are interned into
+// dense indexes the first time they are seen and looked up without locks after that.
+class Metrics {
+public:
+    // distinct types or peers kept apart; later ones are counted together as "other"
+    static constexpr size_t MaxKeys = 128;
+
+    enum class Counter {
+        BytesIn,
+        BytesOut,
+        RpcRetries,
+        RpcTimeouts,
+        DroppedReplies,
+        Count
+    };
+
+    struct InOut {
+        uint64_t in = 0;
+        uint64_t out = 0;
+    };
+
+    // Taken in one pass over the shards. Every counter is exact as of some moment during the pass;
+    // message totals are the sums of byType, so the two always agree.
+    struct Snapshot {
+        uint64_t messagesIn = 0;
+        uint64_t messagesOut = 0;
+        std::array<uint64_t, static_cast<size_t>(Counter::Count)> counters{};
+        std::map<std::string, InOut> byType;
+        std::map<std::string, InOut> byPeer;
+
+        [[nodiscard]] uint64_t operator[](Counter c) const {
+            return counters[static_cast<size_t>(c)];
+        }
+    };
+
+    void add(Counter c, uint64_t n = 1);
+    void received(std::string_view type, std::string_view peer, size_t bytes);
+    void sent(std::string_view type, std::string_view peer, size_t bytes);
+    [[nodiscard]] Snapshot snapshot() const;
+
+private:
+    // Interns keys into [0, MaxKeys). Keys already seen are found by probing an atomic open-addressed
+    // table; only a key's first sighting takes the mutex.
+    class KeyTable {
+    public:
+        size_t indexOf(std::string_view key);
+        // names by index, for the indexes handed out so far
+        [[nodiscard]] std::deque<std::string> names() const;
+
+    private:
+        struct Key {
+            std::string name;
+            size_t index;
+        };
+        static constexpr size_t Slots = 2 * MaxKeys;
+
+        std::array<std::atomic<const Key *>, Slots> slots{};
+        mutable std::mutex m;
+        // stable addresses for the slots to point at
+        std::deque<Key> keys;
+        std::deque<std::string> indexNames;
+    };
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> counters{};
+        std::array<std::atomic<uint64_t>, MaxKeys> typeIn{};
+        std::array<std::atomic<uint64_t>, MaxKeys> typeOut{};
+        std::array<std::atomic<uint64_t>, MaxKeys> peerIn{};
+        std::array<std::atomic<uint64_t>, MaxKeys> peerOut{};
+    };
+
+    KeyTable types;
+    KeyTable peers;
+    Sharded<Shard> shards;
+};
+
+#endif //FLYIO_CHALLENGES_METRICS_H
@@ -0,0 +1,24 @@
+#include "NodeIndex.h"
+
+NodeIndex::NodeIndex(const std::vector<std::string> &nodeIds) : names(nodeIds) {
+    ordinals.reserve(names.size());
+    for (uint32_t i = 0; i < names.size(); i++) {
+        ordinals.emplace(names[i], i);
+    }
+}
+
+size_t NodeIndex::size() const {
+    return names.size();
+}
+
+uint32_t NodeIndex::ordinal(const std::string &nodeId) const {
+    auto it = ordinals.find(nodeId);
+    if (it == ordinals.end()) {
+        return Unknown;
+    }
+    return it->second;
+}
+
+const std::string &NodeIndex::name(uint32_t ordinal) const {
+    return names.at(ordinal);
+}
@@ -0,0 +1,26 @@
+#ifndef FLYIO_CHALLENGES_NODEINDEX_H
+#define FLYIO_CHALLENGES_NODEINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interns the node ids from init into dense ordinals. Every node receives the same
+// node_ids list, so ordinals agree across the cluster and can be sent on the wire.
+class NodeIndex {
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ordinals;
+public:
+    static constexpr uint32_t Unknown = UINT32_MAX;
+
+    NodeIndex() = default;
+    explicit NodeIndex(const std::vector<std::string> &nodeIds);
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] uint32_t ordinal(const std::string &nodeId) const;
+    [[nodiscard]] const std::string &name(uint32_t ordinal) const;
+};
+
+#endif //FLYIO_CHALLENGES_NODEINDEX_H
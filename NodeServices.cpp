@@ -0,0 +1,139 @@
+#include "NodeServices.h"
+
+#include <cstdlib>
+#include <set>
+
+ServiceOptions ServiceOptions::fromEnv() {
+    ServiceOptions options;
+    options.linKvOffsets = getenv("FLYIO_LOG_LIN_KV") != nullptr;
+    options.causalBroadcast = getenv("FLYIO_BROADCAST_CAUSAL") != nullptr;
+    return options;
+}
+
+void NodeServices::registerBroadcastHandlers(Node &node) {
+    node.on<Broadcast>([&node](const Request<Broadcast>& req) {
+        node.reply(req, BroadcastOk{});
+        int64_t msg = req.body.message;
+        bool new_msg = false;
+        set<string> peers_to_send_to;
+        {
+            lock_guard<mutex> lock(node.messagesMutex);
+            node.peerMessages[node.nodeId].insert(msg);
+            if (node.peers.contains(req.src)) {
+                node.peerMessages[req.src].insert(msg);
+            }
+            new_msg = node.messages.insert(msg).second;
+            if (new_msg) {
+                // The sender keeps sending to its own neighbours until they ack, so only peers outside its
+                // reach are ours. Following senders back leads to the node a client told, which skips no
+                // one, so every node still gets the message.
+                auto senderNeighbours = node.neighbours.find(req.src);
+                for (auto& peer : node.peers) {
+                    bool sendersJob = senderNeighbours != node.neighbours.end() && senderNeighbours->second.contains(peer);
+                    if (!sendersJob && !node.peerMessages[peer].contains(msg)) {
+                        peers_to_send_to.insert(peer);
+                    }
+                }
+            }
+        }
+        if (new_msg && node.onBroadcastReadable) {
+            node.onBroadcastReadable(msg);
+        }
+        if (new_msg) {
+            LOG_DEBUG("Node ", node.nodeId, " received new message ", msg);
+            // Each pass sends to every peer still missing the message at once, so a pass costs one RPC
+            // timeout however many peers are unreachable.
+            while (!peers_to_send_to.empty()) {
+                mutex passMutex;
+                Scheduler::WaitList passDone;
+                size_t outstanding = peers_to_send_to.size();
+                vector<string> acked;
+                for (auto& peer : peers_to_send_to) {
+                    node.scheduler->spawn([&node, &passMutex, &passDone, &outstanding, &acked, peer, msg]() {
+                        bool ok = false;
+                        try {
+                            ok = node.rpc(peer, Broadcast{msg})["type"] == "broadcast_ok";
+                        } catch (exception& e) {
+                            // retried next pass like a timeout; the pass must still hear from every peer
+                            LOG_WARN("Node ", node.nodeId, " failed to send ", msg, " to ", peer, ": ", e.what());
+                        }
+                        if (ok) {
+                            LOG_TRACE("Node ", node.nodeId, " received ack from ", peer, " for msg: ", msg);
+                            lock_guard<mutex> lock(node.messagesMutex);
+                            node.peerMessages[peer].insert(msg);
+                        }
+                        lock_guard<mutex> lock(passMutex);
+                        if (ok) {
+                            acked.push_back(peer);
+                        }
+                        if (--outstanding == 0) {
+                            passDone.notifyAll();
+                        }
+                    });
+                }
+                {
+                    unique_lock<mutex> lock(passMutex);
+                    passDone.wait(*node.scheduler, lock, [&outstanding]() {
+                        return outstanding == 0;
+                    });
+                }
+                for (auto& peer : acked) {
+                    peers_to_send_to.erase(peer);
+                }
+                if (!peers_to_send_to.empty()) {
+                    // wait a bit before trying again
+                    node.scheduler->sleepFor(chrono::milliseconds(100));
+                }
+            }
+            LOG_DEBUG("Node ", node.nodeId, " finished broadcasting message ", msg);
+        }
+    });
+
+    node.on<Read>([&node](const Request<Read>& req) {
+        if (!req.msgId) {
+            throw runtime_error("Cannot reply to a message without a msg_id");
+        }
+        // Written straight from the set under the lock; copying it into a ReadOk first would allocate per message.
+        string body;
+        {
+            lock_guard<mutex> lock(node.messagesMutex);
+            body.reserve(64 + node.messages.size() * 21);
+            JsonWriter w(body);
+            w.beginObject();
+            w.field("type", ReadOk::type);
+            w.key("messages");
+            schema::encode(w, node.messages);
+            w.field("in_reply_to", *req.msgId);
+            w.endObject();
+        }
+        node.sendRaw(req.src, ReadOk::type, body, nullopt, req.msgId);
+    });
+
+    node.on<Topology>([&node](const Request<Topology>& req) {
+        auto mine = req.body.topology.find(node.nodeId);
+        {
+            lock_guard<mutex> lock(node.messagesMutex);
+            if (mine != req.body.topology.end()) {
+                node.peers.insert(mine->second.begin(), mine->second.end());
+            }
+            for (auto& [id, theirs] : req.body.topology) {
+                node.neighbours[id].insert(theirs.begin(), theirs.end());
+            }
+        }
+        node.reply(req, TopologyOk{});
+    });
+}
+
+void NodeServices::registerHandlers(Node &node, const ServiceOptions &options) {
+    registerBroadcastHandlers(node);
+    if (options.causalBroadcast) {
+        // replaces the broadcast and read handlers above
+        causalBroadcast.registerHandlers(node);
+    }
+
+    kafkaLog.linKvOffsets = options.linKvOffsets;
+    kafkaLog.registerHandlers(node);
+
+    txnStore.registerHandlers(node);
+    txnReplicator.registerHandlers(node);
+}
@@ -0,0 +1,35 @@
+#ifndef FLYIO_CHALLENGES_NODESERVICES_H
+#define FLYIO_CHALLENGES_NODESERVICES_H
+
+#include "node.h"
+#include "CausalBroadcast.h"
+#include "KafkaLog.h"
+#include "Messages.h"
+#include "TxnReplicator.h"
+#include "TxnStore.h"
+
+struct ServiceOptions {
+    // lease log offsets from lin-kv instead of assigning them on the owner
+    bool linKvOffsets = false;
+    // deliver broadcasts in causal order (CausalBroadcast) instead of plain gossip
+    bool causalBroadcast = false;
+
+    // FLYIO_LOG_LIN_KV / FLYIO_BROADCAST_CAUSAL, set to anything
+    static ServiceOptions fromEnv();
+};
+
+// Every workload a node serves, so the stdio binary and the in-process simulator run the same handlers.
+class NodeServices {
+public:
+    void registerHandlers(Node &node, const ServiceOptions &options);
+
+private:
+    KafkaLog kafkaLog;
+    TxnStore txnStore;
+    TxnReplicator txnReplicator{txnStore};
+    CausalBroadcast causalBroadcast;
+
+    static void registerBroadcastHandlers(Node &node);
+};
+
+#endif //FLYIO_CHALLENGES_NODESERVICES_H
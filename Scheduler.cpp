@@ -0,0 +1,100 @@
+#include "Scheduler.h"
+
+#include <thread>
+
+void Scheduler::Slot::fill(nlohmann::json v) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (value) {
+            return;
+        }
+        value = std::move(v);
+        if (!waiting) {
+            return;
+        }
+        waiting = false;
+    }
+    scheduler.resume(waiter);
+}
+
+nlohmann::json Scheduler::Slot::take() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (value) {
+            return std::move(*value);
+        }
+        waiting = true;
+    }
+    scheduler.park(waiter);
+    std::lock_guard<std::mutex> lock(m);
+    return std::move(*value);
+}
+
+void Scheduler::WaitList::wait(Scheduler &scheduler, std::unique_lock<std::mutex> &lock,
+                               const std::function<bool()> &ready) {
+    while (!ready()) {
+        Parked p;
+        waiters.emplace_back(&scheduler, &p);
+        lock.unlock();
+        scheduler.park(p);
+        // the waker still holds the mutex, so p stays alive until resume() is done with it
+        lock.lock();
+    }
+}
+
+void Scheduler::WaitList::notifyOne() {
+    if (waiters.empty()) {
+        return;
+    }
+    auto [scheduler, p] = waiters.front();
+    waiters.pop_front();
+    scheduler->resume(*p);
+}
+
+void Scheduler::WaitList::notifyAll() {
+    for (auto [scheduler, p] : std::exchange(waiters, {})) {
+        scheduler->resume(*p);
+    }
+}
+
+Scheduler &Scheduler::realTime() {
+    static RealTimeScheduler scheduler;
+    return scheduler;
+}
+
+Scheduler::Clock::time_point RealTimeScheduler::now() {
+    return Clock::now();
+}
+
+std::chrono::system_clock::time_point RealTimeScheduler::wallTime() {
+    return std::chrono::system_clock::now();
+}
+
+void RealTimeScheduler::sleepFor(Clock::duration d) {
+    std::this_thread::sleep_for(d);
+}
+
+void RealTimeScheduler::spawn(std::function<void()> task) {
+    std::thread(std::move(task)).detach();
+}
+
+void RealTimeScheduler::runAfter(Clock::duration d, std::function<void()> task) {
+    std::thread([d, task = std::move(task)]() {
+        std::this_thread::sleep_for(d);
+        task();
+    }).detach();
+}
+
+void RealTimeScheduler::park(Parked &p) {
+    std::unique_lock<std::mutex> lock(p.m);
+    p.cv.wait(lock, [&p]() { return p.resumed; });
+    p.resumed = false;
+}
+
+void RealTimeScheduler::resume(Parked &p) {
+    {
+        std::lock_guard<std::mutex> lock(p.m);
+        p.resumed = true;
+    }
+    p.cv.notify_one();
+}
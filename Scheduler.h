@@ -0,0 +1,86 @@
+#ifndef FLYIO_CHALLENGES_SCHEDULER_H
+#define FLYIO_CHALLENGES_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include "json.hpp"
+
+// Time source and thread control for a Node. Everything a node does that sleeps, times out or waits on
+// another thread goes through here, so the simulator can run nodes on virtual time instead of the wall
+// clock. Node uses realTime() unless its scheduler is replaced before handlers are registered.
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A thread suspended in park() until resume() is called for it.
+    struct Parked {
+        std::mutex m;
+        std::condition_variable cv;
+        bool resumed = false;
+        // the participant suspended here, for schedulers that switch between participants themselves
+        void *participant = nullptr;
+    };
+
+    // Threads waiting for a condition another thread makes true, like a condition_variable, but suspended
+    // through park() so the simulator's participants can wait on each other as well. The caller's mutex
+    // guards the condition and the list alike.
+    class WaitList {
+    public:
+        // Returns once ready() holds; `lock` is released while parked and held again on return.
+        void wait(Scheduler &scheduler, std::unique_lock<std::mutex> &lock, const std::function<bool()> &ready);
+        // Wakes waiters to recheck their condition; call with the mutex held.
+        void notifyOne();
+        void notifyAll();
+
+    private:
+        std::deque<std::pair<Scheduler *, Parked *>> waiters;
+    };
+
+    // One-shot value handed to a thread blocked in take(); the first fill wins.
+    class Slot {
+    public:
+        explicit Slot(Scheduler &scheduler) : scheduler(scheduler) {}
+        void fill(nlohmann::json v);
+        nlohmann::json take();
+
+    private:
+        Scheduler &scheduler;
+        std::mutex m;
+        std::optional<nlohmann::json> value;
+        Parked waiter;
+        bool waiting = false;
+    };
+
+    virtual ~Scheduler() = default;
+    [[nodiscard]] virtual Clock::time_point now() = 0;
+    // Calendar time, for timestamps that other nodes compare against their own.
+    [[nodiscard]] virtual std::chrono::system_clock::time_point wallTime() = 0;
+    virtual void sleepFor(Clock::duration d) = 0;
+    // Runs task on a thread of its own.
+    virtual void spawn(std::function<void()> task) = 0;
+    // Runs task once, d from now.
+    virtual void runAfter(Clock::duration d, std::function<void()> task) = 0;
+    virtual void park(Parked &p) = 0;
+    virtual void resume(Parked &p) = 0;
+
+    static Scheduler &realTime();
+};
+
+// Wall-clock scheduler: plain sleeps, a detached thread per spawn and per timer.
+class RealTimeScheduler : public Scheduler {
+public:
+    Clock::time_point now() override;
+    std::chrono::system_clock::time_point wallTime() override;
+    void sleepFor(Clock::duration d) override;
+    void spawn(std::function<void()> task) override;
+    void runAfter(Clock::duration d, std::function<void()> task) override;
+    void park(Parked &p) override;
+    void resume(Parked &p) override;
+};
+
+#endif //FLYIO_CHALLENGES_SCHEDULER_H
@@ -0,0 +1,9 @@
+#include "ThreadShard.h"
+
+#include <atomic>
+
+size_t threadShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+    return shard;
+}
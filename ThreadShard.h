@@ -0,0 +1,59 @@
+#ifndef FLYIO_CHALLENGES_THREADSHARD_H
+#define FLYIO_CHALLENGES_THREADSHARD_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Hot-path statistics are split into ShardCount shards so concurrent handler threads seldom write the
+// same cache line. Each thread sticks to one shard, handed out round-robin the first time it asks;
+// readers sum every shard.
+constexpr size_t ShardCount = 8;
+
+size_t threadShard();
+
+// ShardCount copies of T, each allocated the first time a thread of its shard writes, so statistics
+// nobody records cost a few pointers. T should be cache-line aligned.
+template<typename T>
+class Sharded {
+public:
+    Sharded() = default;
+    Sharded(const Sharded &) = delete;
+    Sharded &operator=(const Sharded &) = delete;
+
+    ~Sharded() {
+        for (auto &s : shards) {
+            delete s.load();
+        }
+    }
+
+    // The calling thread's shard.
+    T &local() {
+        std::atomic<T *> &slot = shards[threadShard()];
+        T *s = slot.load(std::memory_order_acquire);
+        if (s == nullptr) {
+            auto *fresh = new T;
+            if (slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) {
+                s = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        return *s;
+    }
+
+    // Calls f with every shard allocated so far.
+    template<typename F>
+    void forEach(F &&f) const {
+        for (auto &slot : shards) {
+            if (const T *s = slot.load(std::memory_order_acquire)) {
+                f(*s);
+            }
+        }
+    }
+
+private:
+    std::array<std::atomic<T *>, ShardCount> shards{};
+};
+
+#endif //FLYIO_CHALLENGES_THREADSHARD_H
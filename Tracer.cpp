@@ -0,0 +1,133 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+#include "json.hpp"
+#include "Log.h"
+
+namespace {
+
+template<size_t N>
+void copyTruncated(std::array<char, N> &dst, std::string_view src) {
+    size_t n = std::min(src.size(), N - 1);
+    std::copy_n(src.data(), n, dst.data());
+    dst[n] = '\0';
+}
+
+uint32_t threadNumber() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+uint64_t flowId(std::string_view requester, int64_t msgId, uint64_t salt) {
+    uint64_t h = std::hash<std::string_view>{}(requester);
+    h ^= static_cast<uint64_t>(msgId) * 0x9E3779B97F4A7C15ULL + salt;
+    // trace viewers read ids as doubles
+    return h & ((uint64_t{1} << 53) - 1);
+}
+
+std::atomic<int> pendingSignal{0};
+
+void noteSignal(int signal) {
+    pendingSignal.store(signal);
+}
+
+}
+
+Tracer::Tracer(std::string path) : path(std::move(path)) {}
+
+uint64_t Tracer::requestFlow(std::string_view requester, int64_t msgId) {
+    return flowId(requester, msgId, 0);
+}
+
+uint64_t Tracer::replyFlow(std::string_view requester, int64_t msgId) {
+    return flowId(requester, msgId, 0x5bd1e995);
+}
+
+void Tracer::slice(std::string_view node, std::string_view name, TimePoint start, TimePoint end, uint64_t flow,
+                   char flowPhase) {
+    Ring &ring = rings.local();
+    uint64_t pos = ring.next.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = ring.slots[pos % RingSize];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Event &e = slot.event;
+    e.ts = std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count();
+    e.dur = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    e.flow = flow;
+    e.flowPhase = flowPhase;
+    e.tid = threadNumber();
+    copyTruncated(e.node, node);
+    copyTruncated(e.name, name);
+    slot.seq.store(pos + 1, std::memory_order_release);
+}
+
+void Tracer::dump() {
+    std::vector<Event> events;
+    rings.forEach([&events](const Ring &ring) {
+        for (auto &slot : ring.slots) {
+            uint64_t before = slot.seq.load(std::memory_order_acquire);
+            if (before == 0) {
+                continue;
+            }
+            Event copy = slot.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // skip slots rewritten while we copied them
+            if (slot.seq.load(std::memory_order_relaxed) == before) {
+                events.push_back(copy);
+            }
+        }
+    });
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.ts < b.ts; });
+
+    using nlohmann::json;
+    std::map<std::string, int> pids;
+    json out = json::array();
+    for (auto &e : events) {
+        std::string node = e.node.data();
+        auto [it, added] = pids.emplace(node, static_cast<int>(pids.size()) + 1);
+        if (added) {
+            out.push_back({{"ph", "M"}, {"name", "process_name"}, {"pid", it->second}, {"args", {{"name", node}}}});
+        }
+        out.push_back({{"ph", "X"}, {"name", e.name.data()}, {"pid", it->second}, {"tid", e.tid},
+                       {"ts", e.ts}, {"dur", e.dur}});
+        if (e.flowPhase != 0) {
+            json flow = {{"ph", std::string(1, e.flowPhase)}, {"name", "message"}, {"cat", "message"},
+                         {"id", e.flow}, {"pid", it->second}, {"tid", e.tid}, {"ts", e.ts}};
+            if (e.flowPhase == 'f') {
+                // bind to the slice starting here rather than the one enclosing it
+                flow["bp"] = "e";
+            }
+            out.push_back(move(flow));
+        }
+    }
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    file << json{{"traceEvents", out}, {"displayTimeUnit", "ms"}}.dump() << '\n';
+}
+
+void Tracer::dumpOnSignals(Tracer &tracer) {
+    std::signal(SIGUSR1, noteSignal);
+    std::signal(SIGTERM, noteSignal);
+    // signal handlers can only set a flag; a watcher thread does the writing
+    std::thread([&tracer]() {
+        while (true) {
+            int signal = pendingSignal.exchange(0);
+            if (signal != 0) {
+                tracer.dump();
+            }
+            if (signal == SIGTERM) {
+                // _Exit skips the exit path, so the async log would lose whatever it still holds
+                Log::flush();
+                std::_Exit(0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }).detach();
+}
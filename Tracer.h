@@ -0,0 +1,68 @@
+#ifndef FLYIO_CHALLENGES_TRACER_H
+#define FLYIO_CHALLENGES_TRACER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "ThreadShard.h"
+
+// Optional message-flow trace for one or more nodes, written as Chrome trace-event JSON (chrome://tracing,
+// ui.perfetto.dev). Nodes record handler runs, sends, RPCs and timeouts; each request is linked to its
+// handling and each reply to the RPC that gets it by flow arrows keyed on (requester, msg_id), so the
+// same flow id is computed independently on both ends, across nodes traced into the same file.
+// Events go into a fixed ring per thread shard; when a ring wraps, its oldest events are overwritten.
+class Tracer {
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Event {
+        int64_t ts = 0;
+        int64_t dur = 0;
+        // 0 for none
+        uint64_t flow = 0;
+        // 's' starts the flow at this event, 'f' ends it
+        char flowPhase = 0;
+        uint32_t tid = 0;
+        std::array<char, 16> node{};
+        std::array<char, 48> name{};
+    };
+
+    explicit Tracer(std::string path);
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    // A slice from `start` to `end` on the calling thread.
+    void slice(std::string_view node, std::string_view name, TimePoint start, TimePoint end,
+               uint64_t flow = 0, char flowPhase = 0);
+    // Writes everything still in the rings to the path given at construction; safe while nodes run.
+    void dump();
+
+    // The flow for a request with msg_id from `requester`, or for the reply to it.
+    static uint64_t requestFlow(std::string_view requester, int64_t msgId);
+    static uint64_t replyFlow(std::string_view requester, int64_t msgId);
+
+    // Dumps `tracer` on SIGUSR1, and on SIGTERM before flushing the log and exiting.
+    static void dumpOnSignals(Tracer &tracer);
+
+private:
+    static constexpr size_t RingSize = 4096;
+
+    struct Slot {
+        // 0 while being written, else the ring position + 1 of the event it holds
+        std::atomic<uint64_t> seq{0};
+        Event event;
+    };
+
+    struct alignas(64) Ring {
+        std::atomic<uint64_t> next{0};
+        std::array<Slot, RingSize> slots;
+    };
+
+    std::string path;
+    Sharded<Ring> rings;
+};
+
+#endif //FLYIO_CHALLENGES_TRACER_H
@@ -0,0 +1,34 @@
+#include "TrafficRecorder.h"
+
+#include <charconv>
+#include <stdexcept>
+
+TrafficRecorder::TrafficRecorder(const std::string &path) : out(path, std::ios::out | std::ios::trunc) {
+    if (!out) {
+        throw std::runtime_error("cannot open capture file " + path);
+    }
+}
+
+void TrafficRecorder::record(Direction direction, std::string_view line, std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m);
+    if (!start) {
+        start = now;
+    }
+    auto at = std::chrono::duration_cast<std::chrono::microseconds>(now - *start).count();
+    out << at << '\t' << static_cast<char>(direction) << '\t' << line << '\n';
+    out.flush();
+}
+
+std::optional<TrafficRecorder::Entry> TrafficRecorder::parse(std::string_view record) {
+    int64_t at = 0;
+    auto [end, ec] = std::from_chars(record.data(), record.data() + record.size(), at);
+    size_t pos = end - record.data();
+    if (ec != std::errc() || record.size() < pos + 3 || record[pos] != '\t' || record[pos + 2] != '\t') {
+        return std::nullopt;
+    }
+    char direction = record[pos + 1];
+    if (direction != static_cast<char>(Direction::Inbound) && direction != static_cast<char>(Direction::Outbound)) {
+        return std::nullopt;
+    }
+    return Entry{std::chrono::microseconds(at), static_cast<Direction>(direction), std::string(record.substr(pos + 3))};
+}
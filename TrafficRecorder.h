@@ -0,0 +1,42 @@
+#ifndef FLYIO_CHALLENGES_TRAFFICRECORDER_H
+#define FLYIO_CHALLENGES_TRAFFICRECORDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Capture file of everything a node reads and writes, for flyio_replay. One line per message:
+//   <microseconds since the first record> TAB <'<' inbound | '>' outbound> TAB <the JSON line>
+// Every record is flushed, so a capture survives the node being killed.
+class TrafficRecorder {
+public:
+    enum class Direction : char {
+        Inbound = '<',
+        Outbound = '>'
+    };
+
+    struct Entry {
+        std::chrono::microseconds at;
+        Direction direction;
+        std::string line;
+    };
+
+    // Throws std::runtime_error if the file cannot be opened for writing.
+    explicit TrafficRecorder(const std::string &path);
+
+    void record(Direction direction, std::string_view line, std::chrono::steady_clock::time_point now);
+
+    // nullopt for lines that are not records
+    static std::optional<Entry> parse(std::string_view record);
+
+private:
+    std::mutex m;
+    std::ofstream out;
+    std::optional<std::chrono::steady_clock::time_point> start;
+};
+
+#endif //FLYIO_CHALLENGES_TRAFFICRECORDER_H
@@ -0,0 +1,168 @@
+#include "TxnReplicator.h"
+
+TxnReplicator::TxnReplicator(TxnStore &store) : store(store) {}
+
+vector<string> TxnReplicator::replicaPeers() const {
+    // every other node, whatever the topology: receive() does not re-forward, so a write only reaches the
+    // nodes its origin sends it to
+    vector<string> peers;
+    for (auto &id : node->nodeIds) {
+        if (id != node->nodeId) {
+            peers.push_back(id);
+        }
+    }
+    return peers;
+}
+
+void TxnReplicator::enqueue(const vector<TxnStore::ReplicatedWrite> &writes) {
+    vector<string> replicas = replicaPeers();
+    lock_guard<mutex> lock(peersMutex);
+    for (auto &peer : replicas) {
+        auto &buffer = peers[peer].pending;
+        for (auto &w : writes) {
+            auto [it, inserted] = buffer.try_emplace(w.key, Pending{w});
+            if (inserted) {
+                continue;
+            }
+            // Local writes to a key always cover the previous one, so the older write need not be sent.
+            const auto &current = it->second.write;
+            if (w.context.getTime(current.dot.node) >= current.dot.counter ||
+                TxnStore::supersedes(w.timestamp, w.dot.node, current.timestamp, current.dot.node)) {
+                it->second = Pending{w};
+            }
+        }
+    }
+}
+
+void TxnReplicator::flush() {
+    vector<pair<string, json>> batches;
+    {
+        lock_guard<mutex> lock(peersMutex);
+        auto now = node->scheduler->now();
+        for (auto &[name, peer] : peers) {
+            json writes = json::array();
+            json clocks = json::array();
+            vector<const CompactVectorClock *> distinctClocks;
+            CompactVectorClock batchClock = peer.base;
+            uint64_t batchId = 0;
+            for (auto &[key, p] : peer.pending) {
+                if (p.batchId != 0 && now - p.sentAt < RetransmitAfter) {
+                    continue;
+                }
+                if (batchId == 0) {
+                    batchId = nextBatchId++;
+                }
+                p.batchId = batchId;
+                p.sentAt = now;
+                // writes often share a causal context; send each distinct one once
+                size_t clockIndex = 0;
+                while (clockIndex < distinctClocks.size() && !distinctClocks[clockIndex]->isEqual(p.write.context)) {
+                    clockIndex++;
+                }
+                if (clockIndex == distinctClocks.size()) {
+                    distinctClocks.push_back(&p.write.context);
+                    clocks.push_back(p.write.context.deltaFrom(peer.base));
+                    batchClock.update(p.write.context);
+                }
+                const Dot &dot = p.write.dot;
+                writes.push_back({p.write.key, p.write.value, clockIndex, dot.node, dot.counter, p.write.timestamp});
+            }
+            if (batchId == 0) {
+                continue;
+            }
+            batches.emplace_back(name, json{
+                    {"type", "txn_replicate"},
+                    {"batch_id", batchId},
+                    {"base_id", peer.baseId},
+                    {"clock", batchClock.deltaFrom(peer.base)},
+                    {"clocks", move(clocks)},
+                    {"writes", move(writes)}
+            });
+            peer.unackedClocks.emplace(batchId, move(batchClock));
+        }
+    }
+    for (auto &[peer, body] : batches) {
+        node->send(peer, body);
+    }
+}
+
+void TxnReplicator::acknowledge(const string &name, uint64_t batchId) {
+    lock_guard<mutex> lock(peersMutex);
+    auto it = peers.find(name);
+    if (it == peers.end()) {
+        return;
+    }
+    Peer &peer = it->second;
+    // entries overwritten since they were sent carry batchId 0 and stay buffered
+    erase_if(peer.pending, [batchId](const auto &entry) {
+        return entry.second.batchId == batchId;
+    });
+    auto acked = peer.unackedClocks.find(batchId);
+    if (acked == peer.unackedClocks.end() || batchId < peer.baseId) {
+        return;
+    }
+    peer.baseId = batchId;
+    peer.base = move(acked->second);
+    peer.unackedClocks.erase(peer.unackedClocks.begin(), next(acked));
+}
+
+void TxnReplicator::receive(const json &req) {
+    string src = req["src"];
+    const json &body = req["body"];
+    uint64_t batchId = body["batch_id"];
+    uint64_t baseId = body["base_id"];
+    vector<TxnStore::ReplicatedWrite> writes;
+    {
+        lock_guard<mutex> lock(peersMutex);
+        auto &known = receivedClocks[src];
+        CompactVectorClock base;
+        if (baseId != 0) {
+            auto it = known.find(baseId);
+            if (it == known.end()) {
+                // A late batch built on a base we have since dropped; its writes will be resent.
+                LOG_WARN("Dropping txn_replicate ", batchId, " from ", src, ": unknown base ", baseId);
+                return;
+            }
+            base = it->second;
+            // the sender only moves its base forward, so older bases are never referenced again
+            known.erase(known.begin(), it);
+        }
+        size_t nodes = node->nodeIndex.size();
+        known[batchId] = CompactVectorClock::fromDelta(base, body["clock"].get<vector<int32_t>>(), nodes);
+        vector<CompactVectorClock> clocks;
+        for (auto &delta : body["clocks"]) {
+            clocks.push_back(CompactVectorClock::fromDelta(base, delta.get<vector<int32_t>>(), nodes));
+        }
+        for (auto &w : body["writes"]) {
+            Dot dot{w[3].get<uint32_t>(), w[4].get<int32_t>()};
+            if (dot.node >= nodes) {
+                throw invalid_argument("txn_replicate write from unknown node ordinal " + to_string(dot.node));
+            }
+            writes.push_back({w[0], w[1], dot, clocks.at(w[2].get<size_t>()), w[5]});
+        }
+    }
+    store.applyReplicated(writes);
+    node->send(src, {{"type", "txn_replicate_ok"}, {"batch_id", batchId}});
+}
+
+void TxnReplicator::registerHandlers(Node &n) {
+    node = &n;
+    store.onCommit = [this](const vector<TxnStore::ReplicatedWrite> &writes) {
+        enqueue(writes);
+    };
+
+    n.on("txn_replicate", [this](const json& req) {
+        receive(req);
+    });
+
+    n.on("txn_replicate_ok", [this](const json& req) {
+        acknowledge(req["src"], req["body"]["batch_id"]);
+    });
+
+    n.scheduler->spawn([this, &n]() {
+        while (true) {
+            n.scheduler->sleepFor(FlushInterval);
+            flush();
+        }
+    });
+}
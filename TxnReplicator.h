@@ -0,0 +1,61 @@
+#ifndef FLYIO_CHALLENGES_TXNREPLICATOR_H
+#define FLYIO_CHALLENGES_TXNREPLICATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.h"
+#include "TxnStore.h"
+
+// Ships committed txn writes to every other node in periodic batches, whatever the topology.
+// Writes wait in a per-peer buffer keyed by register, where a newer write to the same key replaces
+// the older one (same last-writer-wins order as TxnStore), so each flush carries at most one write per
+// key. Entries stay buffered until the peer acknowledges the batch that carried them and are resent
+// if no acknowledgement arrives within RetransmitAfter.
+// Clocks travel as deltas against the clock of the last batch the peer acknowledged (base_id), which
+// both sides hold, so clock overhead follows how many nodes wrote since then rather than cluster size.
+class TxnReplicator {
+public:
+    static constexpr chrono::milliseconds FlushInterval{50};
+    static constexpr chrono::milliseconds RetransmitAfter{500};
+
+    struct Pending {
+        TxnStore::ReplicatedWrite write;
+        // 0 until the write goes out in a batch
+        uint64_t batchId = 0;
+        Scheduler::Clock::time_point sentAt{};
+    };
+
+    struct Peer {
+        unordered_map<int64_t, Pending> pending;
+        // clock of the newest acknowledged batch; 0 / empty before the first ack
+        uint64_t baseId = 0;
+        CompactVectorClock base;
+        // merged clock of each batch still waiting for an ack
+        map<uint64_t, CompactVectorClock> unackedClocks;
+    };
+
+    explicit TxnReplicator(TxnStore &store);
+    void enqueue(const vector<TxnStore::ReplicatedWrite> &writes);
+    void flush();
+    void registerHandlers(Node &node);
+
+private:
+    TxnStore &store;
+    Node *node = nullptr;
+    mutex peersMutex;
+    unordered_map<string, Peer> peers;
+    // batch clocks received from each sender that may still serve as its delta base
+    unordered_map<string, map<uint64_t, CompactVectorClock>> receivedClocks;
+    uint64_t nextBatchId = 1;
+
+    vector<string> replicaPeers() const;
+    void acknowledge(const string &peer, uint64_t batchId);
+    void receive(const json &req);
+};
+
+#endif //FLYIO_CHALLENGES_TXNREPLICATOR_H
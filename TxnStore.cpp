@@ -0,0 +1,273 @@
+#include "TxnStore.h"
+
+TxnStore::Snapshot::Snapshot(TxnStore &store) : store(store) {
+    size_t start = hash<thread::id>{}(this_thread::get_id()) % ReaderSlots;
+    for (size_t i = 0;; i++) {
+        slot = (start + i) % ReaderSlots;
+        uint64_t expected = 0;
+        // Claim the slot pinning sequence 0 so no writer prunes while we settle on a snapshot.
+        if (store.readers[slot].pinned.compare_exchange_strong(expected, 1)) {
+            break;
+        }
+        if (i % ReaderSlots == ReaderSlots - 1) {
+            this_thread::yield();
+        }
+    }
+    while (true) {
+        snapshotSeq = store.committedSeq.load();
+        store.readers[slot].pinned.store(snapshotSeq + 1);
+        if (store.committedSeq.load() == snapshotSeq) {
+            break;
+        }
+    }
+}
+
+TxnStore::Snapshot::~Snapshot() {
+    store.readers[slot].pinned.store(0, memory_order_release);
+}
+
+TxnStore::~TxnStore() {
+    for (auto &bucket : buckets) {
+        KeyEntry *entry = bucket.load();
+        while (entry != nullptr) {
+            Version *v = entry->head.load();
+            while (v != nullptr) {
+                Version *prev = v->prev;
+                delete v;
+                v = prev;
+            }
+            KeyEntry *next = entry->next;
+            delete entry;
+            entry = next;
+        }
+    }
+}
+
+size_t TxnStore::bucketOf(int64_t key) {
+    return (static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> (64 - BucketBits);
+}
+
+TxnStore::KeyEntry *TxnStore::find(int64_t key) const {
+    for (KeyEntry *e = buckets[bucketOf(key)].load(memory_order_acquire); e != nullptr; e = e->next) {
+        if (e->key == key) {
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+TxnStore::KeyEntry *TxnStore::findOrInsert(int64_t key) {
+    auto &bucket = buckets[bucketOf(key)];
+    KeyEntry *head = bucket.load(memory_order_acquire);
+    for (KeyEntry *e = head; e != nullptr; e = e->next) {
+        if (e->key == key) {
+            return e;
+        }
+    }
+    // Only writers insert, and they hold writeMutex, so a plain publish is enough.
+    auto *entry = new KeyEntry;
+    entry->key = key;
+    entry->next = head;
+    bucket.store(entry, memory_order_release);
+    return entry;
+}
+
+optional<int64_t> TxnStore::read(const Snapshot &snapshot, int64_t key) const {
+    KeyEntry *entry = find(key);
+    if (entry == nullptr) {
+        return nullopt;
+    }
+    for (Version *v = entry->head.load(memory_order_acquire); v != nullptr; v = v->prev) {
+        if (v->seq <= snapshot.seq()) {
+            return v->value;
+        }
+    }
+    return nullopt;
+}
+
+uint64_t TxnStore::oldestPinned() const {
+    uint64_t oldest = committedSeq.load();
+    for (auto &reader : readers) {
+        uint64_t pinned = reader.pinned.load();
+        if (pinned != 0 && pinned - 1 < oldest) {
+            oldest = pinned - 1;
+        }
+    }
+    return oldest;
+}
+
+void TxnStore::prune(Version *head, uint64_t oldest) {
+    // Readers stop at the first version at or below their snapshot, so nothing past the
+    // newest version visible to the oldest pinned snapshot is reachable.
+    Version *v = head;
+    while (v != nullptr && v->seq > oldest) {
+        v = v->prev;
+    }
+    if (v == nullptr) {
+        return;
+    }
+    Version *dead = v->prev;
+    v->prev = nullptr;
+    while (dead != nullptr) {
+        Version *prev = dead->prev;
+        delete dead;
+        dead = prev;
+    }
+}
+
+vector<TxnStore::ReplicatedWrite> TxnStore::commit(uint32_t origin, const vector<pair<int64_t, int64_t>> &writes) {
+    lock_guard<mutex> lock(writeMutex);
+    uint64_t seq = committedSeq.load() + 1;
+    HybridLogicalClock::Timestamp timestamp = hlc.now();
+    vector<KeyEntry *> written;
+    vector<ReplicatedWrite> replicated;
+    written.reserve(writes.size());
+    replicated.reserve(writes.size());
+    for (auto &[key, value] : writes) {
+        KeyEntry *entry = findOrInsert(key);
+        // a local write has seen everything this node knows about the key
+        CompactVectorClock seen = entry->history.context();
+        Dot dot = entry->history.update(seen, origin, value, timestamp);
+        auto *v = new Version{value, seq, timestamp, origin, entry->head.load(memory_order_relaxed)};
+        entry->head.store(v, memory_order_release);
+        written.push_back(entry);
+        replicated.push_back({key, value, dot, move(seen), timestamp});
+    }
+    committedSeq.store(seq);
+    uint64_t oldest = oldestPinned();
+    for (KeyEntry *entry : written) {
+        prune(entry->head.load(memory_order_relaxed), oldest);
+    }
+    return replicated;
+}
+
+bool TxnStore::supersedes(HybridLogicalClock::Timestamp timestamp, uint32_t origin,
+                          HybridLogicalClock::Timestamp currentTimestamp, uint32_t currentOrigin) {
+    if (timestamp != currentTimestamp) {
+        return timestamp > currentTimestamp;
+    }
+    return origin > currentOrigin;
+}
+
+void TxnStore::applyReplicated(const vector<ReplicatedWrite> &writes) {
+    // Advance the clock past the whole batch before touching any entry. receive() clamps rather than
+    // throws, so a skewed sender cannot leave the batch half-applied; its writes keep their own timestamps.
+    HybridLogicalClock::Timestamp newest = 0;
+    for (auto &w : writes) {
+        newest = max(newest, w.timestamp);
+    }
+    if (!hlc.withinSkew(newest)) {
+        LOG_WARN("Replicated batch is stamped beyond the clock skew bound; clamping the local clock");
+    }
+    hlc.receive(newest);
+
+    lock_guard<mutex> lock(writeMutex);
+    uint64_t seq = committedSeq.load() + 1;
+    vector<KeyEntry *> written;
+    for (auto &w : writes) {
+        KeyEntry *entry = findOrInsert(w.key);
+        if (!entry->history.apply(w.dot, w.context, w.value, w.timestamp)) {
+            continue;
+        }
+        const DottedVersionVector::Sibling *winner = entry->history.winner();
+        Version *head = entry->head.load(memory_order_relaxed);
+        if (head != nullptr && head->timestamp == winner->timestamp && head->origin == winner->dot.node) {
+            // the write became a losing sibling; what readers see is unchanged
+            continue;
+        }
+        auto *v = new Version{winner->value, seq, winner->timestamp, winner->dot.node, head};
+        entry->head.store(v, memory_order_release);
+        written.push_back(entry);
+    }
+    if (written.empty()) {
+        return;
+    }
+    committedSeq.store(seq);
+    uint64_t oldest = oldestPinned();
+    for (KeyEntry *entry : written) {
+        prune(entry->head.load(memory_order_relaxed), oldest);
+    }
+}
+
+TxnStore::ParsedTxn TxnStore::ParsedTxn::parse(const vector<TxnOp> &txn) {
+    ParsedTxn parsed;
+    parsed.ops.reserve(txn.size());
+    for (auto &[f, key, value] : txn) {
+        bool write = f == "w";
+        if (write && !value) {
+            throw runtime_error("write to " + to_string(key) + " has no value");
+        }
+        parsed.ops.push_back({write, key, write ? *value : 0});
+        parsed.readOnly = parsed.readOnly && !write;
+    }
+    return parsed;
+}
+
+vector<TxnOp> TxnStore::execute(uint32_t origin, const vector<TxnOp> &txn) {
+    ParsedTxn parsed = ParsedTxn::parse(txn);
+    if (parsed.readOnly) {
+        return executeReadOnly(parsed);
+    }
+    return execute(origin, parsed);
+}
+
+vector<TxnOp> TxnStore::executeReadOnly(const ParsedTxn &txn) {
+    vector<TxnOp> result;
+    result.reserve(txn.ops.size());
+    Snapshot snapshot(*this);
+    for (auto &op : txn.ops) {
+        optional<int64_t> value = read(snapshot, op.key);
+        result.emplace_back("r", op.key, value);
+    }
+    return result;
+}
+
+vector<TxnOp> TxnStore::execute(uint32_t origin, const ParsedTxn &txn) {
+    vector<pair<int64_t, int64_t>> writes;
+    vector<TxnOp> result;
+    result.reserve(txn.ops.size());
+    {
+        Snapshot snapshot(*this);
+        for (auto &op : txn.ops) {
+            if (op.write) {
+                writes.emplace_back(op.key, op.value);
+                result.emplace_back("w", op.key, op.value);
+                continue;
+            }
+            optional<int64_t> value;
+            for (auto it = writes.rbegin(); it != writes.rend(); ++it) {
+                if (it->first == op.key) {
+                    value = it->second;
+                    break;
+                }
+            }
+            if (!value) {
+                value = read(snapshot, op.key);
+            }
+            result.emplace_back("r", op.key, value);
+        }
+    }
+    if (!writes.empty()) {
+        vector<ReplicatedWrite> replicated = commit(origin, writes);
+        if (onCommit) {
+            onCommit(replicated);
+        }
+    }
+    return result;
+}
+
+void TxnStore::registerHandlers(Node &node) {
+    // physical time comes from the node's scheduler, so simulated runs stamp writes with virtual time
+    hlc.setPhysicalClock([&node]() {
+        auto sinceEpoch = node.scheduler->wallTime().time_since_epoch();
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(sinceEpoch).count());
+    });
+    node.on<Txn>([this, &node](const Request<Txn>& req) {
+        uint32_t origin = node.nodeIndex.ordinal(node.nodeId);
+        if (origin == NodeIndex::Unknown) {
+            // dots and clocks are indexed by ordinal, which only init assigns
+            throw runtime_error("txn before init");
+        }
+        node.reply(req, TxnOk{execute(origin, req.body.txn)});
+    });
+}
@@ -0,0 +1,128 @@
+#ifndef FLYIO_CHALLENGES_TXNSTORE_H
+#define FLYIO_CHALLENGES_TXNSTORE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "node.h"
+#include "Messages.h"
+#include "CompactVectorClock.h"
+#include "DottedVersionVector.h"
+#include "HybridLogicalClock.h"
+
+// Multi-version register store behind the txn workload.
+// Every key holds a newest-first chain of versions stamped with the commit sequence that
+// installed them. Readers pin the current sequence in a reader slot and walk chains without
+// locking; writers serialize among themselves, publish new chain heads, and prune versions that
+// no pinned snapshot can reach.
+// Each key also keeps a DottedVersionVector of the writes it has seen. A replicated write that the
+// history already covers is dropped before it touches the chain; truly concurrent writes become
+// siblings, and readers see the sibling with the highest (hybrid logical timestamp, origin ordinal).
+class TxnStore {
+public:
+    struct Version {
+        int64_t value;
+        uint64_t seq;
+        HybridLogicalClock::Timestamp timestamp;
+        // NodeIndex ordinal of the node that committed it
+        uint32_t origin;
+        Version *prev;
+    };
+
+    struct ReplicatedWrite {
+        int64_t key;
+        int64_t value;
+        // dot.node is the origin ordinal
+        Dot dot;
+        // the key's causal context the write was made in; siblings it covers were overwritten
+        CompactVectorClock context;
+        HybridLogicalClock::Timestamp timestamp;
+    };
+
+    struct KeyEntry {
+        int64_t key;
+        atomic<Version *> head{nullptr};
+        KeyEntry *next = nullptr;
+        // only touched by writers, under writeMutex
+        DottedVersionVector history;
+    };
+
+    struct Op {
+        bool write;
+        int64_t key;
+        int64_t value;
+    };
+
+    // Micro-ops decoded once from the request; readOnly is decided here, before any store access.
+    struct ParsedTxn {
+        vector<Op> ops;
+        bool readOnly = true;
+        static ParsedTxn parse(const vector<TxnOp> &txn);
+    };
+
+    // Reader slots sit on their own cache lines so concurrent readers never share one.
+    struct alignas(64) ReaderSlot {
+        // 0 means free; otherwise the pinned sequence + 1
+        atomic<uint64_t> pinned{0};
+    };
+
+    static constexpr size_t BucketBits = 12;
+    static constexpr size_t BucketCount = size_t{1} << BucketBits;
+    static constexpr size_t ReaderSlots = 256;
+
+    // Pins a snapshot for the lifetime of the guard.
+    class Snapshot {
+    public:
+        explicit Snapshot(TxnStore &store);
+        ~Snapshot();
+        Snapshot(const Snapshot &) = delete;
+        Snapshot &operator=(const Snapshot &) = delete;
+        [[nodiscard]] uint64_t seq() const { return snapshotSeq; }
+    private:
+        TxnStore &store;
+        size_t slot;
+        uint64_t snapshotSeq;
+    };
+
+    // Called with the write set of every local transaction after it commits.
+    function<void(const vector<ReplicatedWrite> &)> onCommit;
+
+    TxnStore() = default;
+    ~TxnStore();
+    TxnStore(const TxnStore &) = delete;
+    TxnStore &operator=(const TxnStore &) = delete;
+
+    [[nodiscard]] optional<int64_t> read(const Snapshot &snapshot, int64_t key) const;
+    // Returns the writes as they should be replicated to other nodes.
+    vector<ReplicatedWrite> commit(uint32_t origin, const vector<pair<int64_t, int64_t>> &writes);
+    // Installs writes from other nodes, skipping any the key's history already covers.
+    void applyReplicated(const vector<ReplicatedWrite> &writes);
+    static bool supersedes(HybridLogicalClock::Timestamp timestamp, uint32_t origin,
+                           HybridLogicalClock::Timestamp currentTimestamp, uint32_t currentOrigin);
+    // Runs a list of ["r"|"w", key, value] micro-ops and returns it with reads filled in.
+    vector<TxnOp> execute(uint32_t origin, const vector<TxnOp> &txn);
+    vector<TxnOp> execute(uint32_t origin, const ParsedTxn &txn);
+    // Serves a transaction with no writes from a pinned snapshot; never takes writeMutex or prunes.
+    vector<TxnOp> executeReadOnly(const ParsedTxn &txn);
+    void registerHandlers(Node &node);
+
+private:
+    array<atomic<KeyEntry *>, BucketCount> buckets{};
+    array<ReaderSlot, ReaderSlots> readers{};
+    atomic<uint64_t> committedSeq{0};
+    mutex writeMutex;
+    HybridLogicalClock hlc;
+
+    static size_t bucketOf(int64_t key);
+    [[nodiscard]] KeyEntry *find(int64_t key) const;
+    KeyEntry *findOrInsert(int64_t key);
+    [[nodiscard]] uint64_t oldestPinned() const;
+    static void prune(Version *head, uint64_t oldest);
+};
+
+#endif //FLYIO_CHALLENGES_TXNSTORE_H
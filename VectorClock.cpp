@@ -4,6 +4,8 @@
 
 #include "VectorClock.h"
 
+VectorClock::VectorClock(std::map<std::string, int> entries) : vclock(std::move(entries)) {}
+
 std::ostream &operator<<(std::ostream &os, const VectorClock &vc) {
     os << "{";
     for (auto it = vc.vclock.begin(); it != vc.vclock.end(); ++it) {
@@ -34,27 +36,6 @@ void VectorClock::update(const VectorClock &other) {
     }
 }
 
-bool VectorClock::isConcurrent(const VectorClock &other) const {
-    bool hasGreater = false;
-    bool hasLesser = false;
-    for (const auto &entry : vclock) {
-        const std::string &process = entry.first;
-        int our_time = entry.second;
-        int other_time = other.getTime(process);
-
-        if (our_time > other_time) {
-            hasGreater = true;
-        } else if (our_time < other_time) {
-            hasLesser = true;
-        }
-
-        if (hasGreater && hasLesser) {
-            return true;
-        }
-    }
-    return false;
-}
-
 int VectorClock::getTime(const std::string &process) const {
     if (vclock.find(process) == vclock.end()) {
         return 0;
@@ -62,38 +43,65 @@ int VectorClock::getTime(const std::string &process) const {
     return vclock.at(process);
 }
 
+bool VectorClock::isConcurrent(const VectorClock &other) const {
+    return compare(other) == ClockOrder::Concurrent;
+}
+
 bool VectorClock::isLessThan(const VectorClock &other) const {
-    bool hasLesser = false;
-    for (const auto &entry : vclock) {
-        const std::string &process = entry.first;
-        int our_time = entry.second;
-        int other_time = other.getTime(process);
+    return compare(other) == ClockOrder::Less;
+}
+
+bool VectorClock::isGreaterThan(const VectorClock &other) const {
+    return compare(other) == ClockOrder::Greater;
+}
+
+bool VectorClock::isEqual(const VectorClock &other) const {
+    return compare(other) == ClockOrder::Equal;
+}
 
-        if (our_time > other_time) {
-            return false;
-        } else if (our_time < other_time) {
-            hasLesser = true;
+// Single merge walk over both sorted maps; a process missing from one side counts as 0.
+ClockOrder VectorClock::compare(const VectorClock &other) const {
+    bool hasLesser = false;
+    bool hasGreater = false;
+    auto ours = vclock.begin();
+    auto theirs = other.vclock.begin();
+    while (ours != vclock.end() || theirs != other.vclock.end()) {
+        int order;
+        if (ours == vclock.end()) {
+            order = 1;
+        } else if (theirs == other.vclock.end()) {
+            order = -1;
+        } else {
+            order = ours->first.compare(theirs->first);
+        }
+        int ourTime = order <= 0 ? ours->second : 0;
+        int otherTime = order >= 0 ? theirs->second : 0;
+        if (order <= 0) {
+            ++ours;
         }
+        if (order >= 0) {
+            ++theirs;
+        }
+        hasLesser |= ourTime < otherTime;
+        hasGreater |= ourTime > otherTime;
+    }
+    if (hasLesser && hasGreater) {
+        return ClockOrder::Concurrent;
+    }
+    if (hasLesser) {
+        return ClockOrder::Less;
     }
-    return hasLesser;
+    return hasGreater ? ClockOrder::Greater : ClockOrder::Equal;
 }
 
-bool VectorClock::isGreaterThan(const VectorClock &other) const {
-    bool hasGreater = false;
+int VectorClock::total() const {
+    int sum = 0;
     for (const auto &entry : vclock) {
-        const std::string &process = entry.first;
-        int our_time = entry.second;
-        int other_time = other.getTime(process);
-
-        if (our_time < other_time) {
-            return false;
-        } else if (our_time > other_time) {
-            hasGreater = true;
-        }
+        sum += entry.second;
     }
-    return hasGreater;
+    return sum;
 }
 
-bool VectorClock::isEqual(const VectorClock &other) const {
-    return !isLessThan(other) && !isGreaterThan(other) && !isConcurrent(other);
+const std::map<std::string, int> &VectorClock::entries() const {
+    return vclock;
 }
@@ -10,10 +10,19 @@
 #include <string>
 #include <vector>
 
+enum class ClockOrder {
+    Less,
+    Greater,
+    Equal,
+    Concurrent
+};
+
 class VectorClock {
 private:
     std::map<std::string, int> vclock;
 public:
+    VectorClock() = default;
+    explicit VectorClock(std::map<std::string, int> entries);
     void increment(const std::string &process);
     void update(const VectorClock &other);
     [[nodiscard]] bool isConcurrent(const VectorClock &other) const;
@@ -21,6 +30,9 @@ public:
     bool isLessThan(const VectorClock &other) const;
     bool isGreaterThan(const VectorClock &other) const;
     bool isEqual(const VectorClock &other) const;
+    [[nodiscard]] ClockOrder compare(const VectorClock &other) const;
+    [[nodiscard]] int total() const;
+    [[nodiscard]] const std::map<std::string, int> &entries() const;
     friend std::ostream &operator<<(std::ostream &os, const VectorClock &vc);
 };
 
@@ -0,0 +1,80 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace {
+
+// per thread, so background threads (the txn flush loop, RPC timers) do not show up in the numbers
+thread_local uint64_t threadAllocations = 0;
+thread_local uint64_t threadBytes = 0;
+
+void *allocate(std::size_t size) {
+    threadAllocations++;
+    threadBytes += size;
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+void *operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+AllocationCount AllocationCount::current() {
+    return {threadAllocations, threadBytes};
+}
+
+Bench::Bench(size_t iterations, std::string filter) : iterations(iterations), filter(std::move(filter)) {}
+
+bool Bench::selected(const std::string &group, const std::string &name) const {
+    return (group + "/" + name).find(filter) != std::string::npos;
+}
+
+size_t Bench::warmup() const {
+    return std::max<size_t>(1, iterations / 100);
+}
+
+size_t Bench::callsPerRun() const {
+    return warmup() + iterations;
+}
+
+void Bench::printHeader() {
+    std::cout << std::left << std::setw(14) << "group" << std::setw(40) << "benchmark" << std::right
+              << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::endl;
+}
+
+void Bench::report(const std::string &group, const std::string &name, double ns, uint64_t allocs,
+                   uint64_t bytes) const {
+    auto perOp = [this](double v) { return v / static_cast<double>(iterations); };
+    std::cout << std::left << std::setw(14) << group << std::setw(40) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << perOp(ns) << std::setw(12)
+              << perOp(static_cast<double>(allocs)) << std::setw(12) << perOp(static_cast<double>(bytes))
+              << std::endl;
+}
@@ -0,0 +1,68 @@
+#ifndef FLYIO_CHALLENGES_BENCH_H
+#define FLYIO_CHALLENGES_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Heap allocations made by the calling thread since it started; counted by the operator new in Bench.cpp.
+struct AllocationCount {
+    uint64_t allocations;
+    uint64_t bytes;
+
+    static AllocationCount current();
+};
+
+// Runs and reports the flyio_bench microbenchmarks. Each one runs `iterations` times after a short
+// warm-up and reports ns/op plus the allocations and bytes the calling thread allocated per op.
+class Bench {
+public:
+    Bench(size_t iterations, std::string filter);
+
+    // Whether "group/name" matches the filter given on the command line.
+    [[nodiscard]] bool selected(const std::string &group, const std::string &name) const;
+
+    template<typename F>
+    void run(const std::string &group, const std::string &name, F &&op) {
+        if (!selected(group, name)) {
+            return;
+        }
+        for (size_t i = 0; i < warmup(); i++) {
+            op();
+        }
+        AllocationCount before = AllocationCount::current();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            op();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        AllocationCount after = AllocationCount::current();
+        report(group, name, std::chrono::duration<double, std::nano>(elapsed).count(),
+               after.allocations - before.allocations, after.bytes - before.bytes);
+    }
+
+    // Calls to op one run() makes, warm-up included, for benchmarks that prepare an input per call.
+    [[nodiscard]] size_t callsPerRun() const;
+
+    static void printHeader();
+
+private:
+    size_t iterations;
+    std::string filter;
+
+    [[nodiscard]] size_t warmup() const;
+    void report(const std::string &group, const std::string &name, double ns, uint64_t allocations,
+                uint64_t bytes) const;
+};
+
+// Keeps the optimizer from discarding a benchmarked result.
+template<typename T>
+void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void benchJson(Bench &bench);
+void benchNode(Bench &bench);
+void benchVectorClock(Bench &bench);
+
+#endif //FLYIO_CHALLENGES_BENCH_H
@@ -0,0 +1,28 @@
+// Microbenchmarks for the node's hot paths, to judge each performance change against a baseline.
+// Usage: flyio_bench [filter] [iterations]
+// Only benchmarks whose "group/name" contains filter run; groups are json, node, broadcast and vclock.
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include "Bench.h"
+#include "ClockKernels.h"
+
+int main(int argc, char **argv) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    Bench bench(iterations, filter);
+
+    std::cout << "runtime kernels: " << ClockKernels::best(5).name << " at 5 nodes, " << ClockKernels::best(32).name
+              << " at 32" << std::endl;
+    Bench::printHeader();
+    try {
+        benchJson(bench);
+        benchNode(bench);
+        benchVectorClock(bench);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
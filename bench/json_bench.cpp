@@ -0,0 +1,49 @@
+// json::parse and dump of typical Maelstrom envelopes, and the same envelopes through JsonWriter.
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "Bench.h"
+#include "JsonWriter.h"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+std::vector<std::pair<std::string, std::string>> envelopes() {
+    json readOk = {{"type", "read_ok"}, {"in_reply_to", 3}, {"messages", json::array()}};
+    for (int i = 0; i < 100; i++) {
+        readOk["messages"].push_back(i);
+    }
+    return {
+            {"init", R"({"id":0,"src":"c0","dest":"n1","body":{"type":"init","node_id":"n1","node_ids":["n1","n2","n3","n4","n5"],"msg_id":1}})"},
+            {"broadcast", R"({"id":4,"src":"c1","dest":"n1","body":{"type":"broadcast","message":1000,"msg_id":7}})"},
+            {"broadcast_ok", R"({"id":5,"src":"n2","dest":"n1","body":{"type":"broadcast_ok","in_reply_to":12}})"},
+            {"read_ok/100", json{{"src", "n1"}, {"dest", "c1"}, {"body", readOk}}.dump()},
+            {"send", R"({"id":9,"src":"c2","dest":"n3","body":{"type":"send","key":"k7","msg":123,"msg_id":4}})"},
+            {"poll", R"({"id":10,"src":"c2","dest":"n3","body":{"type":"poll","offsets":{"k7":0,"k8":12},"msg_id":5}})"},
+            {"txn", R"({"id":11,"src":"c3","dest":"n2","body":{"type":"txn","txn":[["r",1,null],["w",1,6],["r",2,null],["w",3,9]],"msg_id":6}})"},
+    };
+}
+
+}
+
+void benchJson(Bench &bench) {
+    for (auto &[name, line] : envelopes()) {
+        bench.run("json", "parse/" + name, [&line] {
+            json j = json::parse(line);
+            doNotOptimize(j);
+        });
+        json parsed = json::parse(line);
+        bench.run("json", "dump/" + name, [&parsed] {
+            std::string out = parsed.dump();
+            doNotOptimize(out);
+        });
+        bench.run("json", "write/" + name, [&parsed] {
+            std::string out;
+            JsonWriter(out).value(parsed);
+            doNotOptimize(out);
+        });
+    }
+}
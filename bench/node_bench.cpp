@@ -0,0 +1,151 @@
+// Node's message path: handle dispatch, send/reply serialization and the broadcast handlers' state.
+// Logging is off while these run: the unknown-type warning would flood stderr. The per-message lines
+// are debug level, compiled out of release builds, so production pays nothing for them either.
+
+#include <set>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "NodeServices.h"
+
+namespace {
+
+json request(const std::string &src, json body) {
+    return {{"src", src}, {"dest", "n1"}, {"body", std::move(body)}};
+}
+
+// A node with every workload's handlers registered, initialized as n1 of five, whose output goes nowhere.
+// Never freed: the txn replicator's flush thread keeps using it.
+Node &newNode() {
+    auto *node = new Node;
+    node->output = [](const std::string &line) {
+        doNotOptimize(line);
+    };
+    (new NodeServices)->registerHandlers(*node, ServiceOptions{});
+    node->handle(request("c0", {{"type", "init"}, {"node_id", "n1"}, {"node_ids", {"n1", "n2", "n3", "n4", "n5"}}, {"msg_id", 1}}));
+    return *node;
+}
+
+std::set<int64_t> numberedMessages(size_t count) {
+    std::set<int64_t> messages;
+    for (size_t i = 0; i < count; i++) {
+        messages.insert(static_cast<int64_t>(i));
+    }
+    return messages;
+}
+
+void benchDispatch(Bench &bench) {
+    Node &node = newNode();
+
+    // a new message each call, with no peers to gossip to: dispatch, reply and the set insert
+    std::vector<json> broadcasts;
+    for (size_t i = 0; i < bench.callsPerRun(); i++) {
+        broadcasts.push_back(request("c1", {{"type", "broadcast"}, {"message", i}, {"msg_id", 2}}));
+    }
+    size_t next = 0;
+    bench.run("node", "handle/broadcast", [&] {
+        node.handle(broadcasts[next++]);
+    });
+    bench.run("node", "handle/broadcast duplicate", [&] {
+        node.handle(broadcasts[0]);
+    });
+
+    // a reply nobody is waiting for any more, e.g. after its RPC timed out
+    json lateReply = request("n2", {{"type", "broadcast_ok"}, {"in_reply_to", 12345}});
+    bench.run("node", "handle/late reply", [&] {
+        node.handle(lateReply);
+    });
+
+    // from the line as read: parsed to json for handle(), or decoded by the typed handler
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < bench.callsPerRun(); i++) {
+        // past the values handle/broadcast stored, so these are new messages too
+        lines.push_back(request("c1", {{"type", "broadcast"}, {"message", bench.callsPerRun() + i}, {"msg_id", 2}}).dump());
+    }
+    next = 0;
+    bench.run("node", "parse+handle/broadcast", [&] {
+        node.handle(json::parse(lines[next++]));
+    });
+    Node &lineNode = newNode();
+    next = 0;
+    bench.run("node", "handleLine/broadcast", [&] {
+        lineNode.handleLine(lines[next++], lineNode.scheduler->now());
+    });
+
+    json unknown = request("c1", {{"type", "nonsense"}, {"msg_id", 3}});
+    bench.run("node", "handle/unknown type", [&] {
+        node.handle(unknown);
+    });
+
+    for (size_t count : {10, 100, 1000}) {
+        Node &reader = newNode();
+        reader.messages = numberedMessages(count);
+        json read = request("c1", {{"type", "read"}, {"msg_id", 4}});
+        bench.run("node", "handle/read " + std::to_string(count), [&] {
+            reader.handle(read);
+        });
+    }
+}
+
+void benchSend(Bench &bench) {
+    Node &node = newNode();
+
+    json ack = {{"type", "broadcast_ok"}, {"in_reply_to", 7}};
+    bench.run("node", "send/ack", [&] {
+        node.send("c1", ack);
+    });
+    std::string rawAck = ack.dump();
+    bench.run("node", "sendRaw/ack", [&] {
+        node.sendRaw("c1", "broadcast_ok", rawAck, std::nullopt, 7);
+    });
+    json gossip = {{"type", "broadcast"}, {"message", 1000}, {"msg_id", 9}};
+    bench.run("node", "send/gossip", [&] {
+        node.send("n2", gossip);
+    });
+
+    json req = request("c1", {{"type", "broadcast"}, {"message", 1000}, {"msg_id", 7}});
+    bench.run("node", "reply/ack", [&] {
+        node.reply(req, {{"type", "broadcast_ok"}});
+    });
+}
+
+void benchBroadcastState(Bench &bench) {
+    std::vector<int64_t> values;
+    for (size_t i = 0; i < bench.callsPerRun(); i++) {
+        values.push_back(static_cast<int64_t>(i));
+    }
+    std::set<int64_t> messages;
+    size_t next = 0;
+    bench.run("broadcast", "set insert new", [&] {
+        doNotOptimize(messages.insert(values[next++]).second);
+    });
+    bench.run("broadcast", "set insert duplicate", [&] {
+        doNotOptimize(messages.insert(values[0]).second);
+    });
+    bench.run("broadcast", "set contains", [&] {
+        doNotOptimize(messages.contains(values[values.size() / 2]));
+    });
+
+    for (size_t count : {10, 100, 1000}) {
+        std::set<int64_t> stored = numberedMessages(count);
+        json in = {{"type", "read"}, {"msg_id", 4}};
+        bench.run("broadcast", "read_ok build " + std::to_string(count), [&] {
+            json body = {{"type", "read_ok"}, {"messages", stored}, {"in_reply_to", in["msg_id"]}};
+            doNotOptimize(body);
+        });
+        json body = {{"type", "read_ok"}, {"messages", stored}, {"in_reply_to", 4}};
+        bench.run("broadcast", "read_ok dump " + std::to_string(count), [&] {
+            std::string line = body.dump();
+            doNotOptimize(line);
+        });
+    }
+}
+
+}
+
+void benchNode(Bench &bench) {
+    Log::setLevel(LogLevel::Off);
+    benchDispatch(bench);
+    benchSend(bench);
+    benchBroadcastState(bench);
+}
@@ -0,0 +1,153 @@
+// Every VectorClock operation against CompactVectorClock and each ClockKernels variant.
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "ClockKernels.h"
+#include "CompactVectorClock.h"
+#include "VectorClock.h"
+
+namespace {
+
+std::vector<int32_t> randomTicks(size_t nodes, std::mt19937 &rng) {
+    std::uniform_int_distribution<int32_t> dist(0, 1000);
+    std::vector<int32_t> ticks(nodes);
+    for (auto &t : ticks) {
+        t = dist(rng);
+    }
+    return ticks;
+}
+
+VectorClock toMapClock(const std::vector<int32_t> &ticks) {
+    std::map<std::string, int> entries;
+    for (size_t i = 0; i < ticks.size(); i++) {
+        entries["n" + std::to_string(i)] = ticks[i];
+    }
+    return VectorClock(std::move(entries));
+}
+
+bool kernelsAgree(const ClockKernels &k, const std::vector<int32_t> &a, const std::vector<int32_t> &b) {
+    bool lesser = false, greater = false, refLesser = false, refGreater = false;
+    k.compare(a.data(), b.data(), a.size(), lesser, greater);
+    ClockKernels::scalar().compare(a.data(), b.data(), a.size(), refLesser, refGreater);
+    std::vector<int32_t> merged = a, refMerged = a;
+    k.maxInto(merged.data(), b.data(), b.size());
+    ClockKernels::scalar().maxInto(refMerged.data(), b.data(), b.size());
+    return lesser == refLesser && greater == refGreater && merged == refMerged;
+}
+
+// Entries present on only one side count as 0, the same in compare() and every predicate.
+void checkMissingEntries() {
+    struct Case {
+        std::map<std::string, int> a;
+        std::map<std::string, int> b;
+        ClockOrder expected;
+    };
+    const std::vector<Case> cases{
+            {{}, {{"a", 1}}, ClockOrder::Less},
+            {{{"a", 1}}, {}, ClockOrder::Greater},
+            {{{"a", 0}}, {}, ClockOrder::Equal},
+            {{{"a", 1}}, {{"a", 1}, {"b", 0}}, ClockOrder::Equal},
+            {{{"a", 1}}, {{"b", 1}}, ClockOrder::Concurrent},
+            {{{"a", 1}, {"b", 2}}, {{"b", 2}}, ClockOrder::Greater},
+            {{{"b", 1}}, {{"a", 1}, {"b", 1}}, ClockOrder::Less},
+    };
+    for (size_t i = 0; i < cases.size(); i++) {
+        VectorClock a(cases[i].a);
+        VectorClock b(cases[i].b);
+        ClockOrder order = a.compare(b);
+        if (order != cases[i].expected || a.isLessThan(b) != (order == ClockOrder::Less) ||
+            a.isGreaterThan(b) != (order == ClockOrder::Greater) || a.isEqual(b) != (order == ClockOrder::Equal) ||
+            a.isConcurrent(b) != (order == ClockOrder::Concurrent)) {
+            throw std::runtime_error("VectorClock predicates disagree on missing-entry case " + std::to_string(i));
+        }
+    }
+}
+
+void benchMapClock(Bench &bench, const std::string &suffix, const std::vector<int32_t> &a,
+                   const std::vector<int32_t> &b) {
+    VectorClock mapA = toMapClock(a);
+    VectorClock mapB = toMapClock(b);
+    std::string middle = "n" + std::to_string(a.size() / 2);
+    bench.run("vclock", "map increment" + suffix, [&] { mapA.increment(middle); });
+    mapA = toMapClock(a);
+    bench.run("vclock", "map update" + suffix, [&] { mapA.update(mapB); });
+    mapA = toMapClock(a);
+    bench.run("vclock", "map getTime" + suffix, [&] { doNotOptimize(mapA.getTime(middle)); });
+    bench.run("vclock", "map isLessThan" + suffix, [&] { doNotOptimize(mapA.isLessThan(mapB)); });
+    bench.run("vclock", "map isGreaterThan" + suffix, [&] { doNotOptimize(mapA.isGreaterThan(mapB)); });
+    bench.run("vclock", "map isEqual" + suffix, [&] { doNotOptimize(mapA.isEqual(mapB)); });
+    bench.run("vclock", "map isConcurrent" + suffix, [&] { doNotOptimize(mapA.isConcurrent(mapB)); });
+    bench.run("vclock", "map compare" + suffix, [&] { doNotOptimize(mapA.compare(mapB)); });
+    bench.run("vclock", "map total" + suffix, [&] { doNotOptimize(mapA.total()); });
+    bench.run("vclock", "map copy" + suffix, [&] {
+        VectorClock copy = mapA;
+        doNotOptimize(copy);
+    });
+}
+
+void benchCompactClock(Bench &bench, const std::string &suffix, const std::vector<int32_t> &a,
+                       const std::vector<int32_t> &b) {
+    CompactVectorClock flatA(a);
+    CompactVectorClock flatB(b);
+    auto middle = static_cast<uint32_t>(a.size() / 2);
+    bench.run("vclock", "compact increment" + suffix, [&] { flatA.increment(middle); });
+    flatA = CompactVectorClock(a);
+    bench.run("vclock", "compact update" + suffix, [&] { flatA.update(flatB); });
+    flatA = CompactVectorClock(a);
+    bench.run("vclock", "compact getTime" + suffix, [&] { doNotOptimize(flatA.getTime(middle)); });
+    bench.run("vclock", "compact compare" + suffix, [&] { doNotOptimize(flatA.compare(flatB)); });
+    bench.run("vclock", "compact total" + suffix, [&] { doNotOptimize(flatA.total()); });
+    bench.run("vclock", "compact deltaFrom" + suffix, [&] {
+        std::vector<int32_t> delta = flatA.deltaFrom(flatB);
+        doNotOptimize(delta);
+    });
+}
+
+}
+
+void benchVectorClock(Bench &bench) {
+    checkMissingEntries();
+    std::mt19937 rng(42);
+    std::vector<const ClockKernels *> kernels{&ClockKernels::scalar()};
+    for (const ClockKernels *k : {ClockKernels::sse41(), ClockKernels::avx2()}) {
+        if (k != nullptr) {
+            kernels.push_back(k);
+        }
+    }
+
+    // 5 and 32 bracket the crossover where ClockKernels::best() switches from sse4.1 to avx2
+    for (size_t nodes : {5, 25, 32, 64}) {
+        std::vector<int32_t> a = randomTicks(nodes, rng);
+        std::vector<int32_t> b = randomTicks(nodes, rng);
+        for (const ClockKernels *k : kernels) {
+            if (!kernelsAgree(*k, a, b)) {
+                throw std::runtime_error(std::string(k->name) + " disagrees with scalar for " +
+                                         std::to_string(nodes) + " nodes");
+            }
+        }
+
+        std::string suffix = " " + std::to_string(nodes);
+        benchMapClock(bench, suffix, a, b);
+        benchCompactClock(bench, suffix, a, b);
+        for (const ClockKernels *k : kernels) {
+            std::vector<int32_t> dst = a;
+            std::string impl = std::string("kernel ") + k->name;
+            bench.run("vclock", impl + " maxInto" + suffix, [&] { k->maxInto(dst.data(), b.data(), nodes); });
+            bench.run("vclock", impl + " compare" + suffix, [&] {
+                bool lesser = false, greater = false;
+                k->compare(a.data(), b.data(), nodes, lesser, greater);
+                doNotOptimize(lesser + 2 * greater);
+            });
+        }
+        const ClockKernels &best = ClockKernels::best(nodes);
+        bench.run("vclock", std::string("best (") + best.name + ") compare" + suffix, [&] {
+            bool lesser = false, greater = false;
+            best.compare(a.data(), b.data(), nodes, lesser, greater);
+            doNotOptimize(lesser + 2 * greater);
+        });
+    }
+}
@@ -0,0 +1,158 @@
+// End-to-end workload benchmarks: runs a fixed suite of flyio_sim scenarios, one process each so peak
+// RSS and CPU time are per scenario, and prints every report as one JSON document that can be saved
+// and compared against a later commit's.
+// Usage: flyio_workloads [--sim PATH] [--only SUBSTRING] [--label TEXT] [--baseline FILE]
+// --baseline prints each metric's change against a saved run to stderr.
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Scenario {
+    std::string name;
+    std::string args;
+};
+
+// Shaped after the Maelstrom tests each workload is graded on; the Maelstrom counter workload has no
+// handler in this node, so it is not here.
+const std::vector<Scenario> &suite() {
+    static const std::vector<Scenario> scenarios{
+            {"broadcast-5", "--workload broadcast --nodes 5 --ops 500 --rate 50"},
+            {"broadcast-25", "--workload broadcast --nodes 25 --ops 200 --rate 20 --latency-us 20000"},
+            {"broadcast-5-partition", "--workload broadcast --nodes 5 --ops 500 --rate 50 --partition-at-ms 2000 --heal-at-ms 6000"},
+            {"broadcast-25-causal", "--workload broadcast --nodes 25 --ops 200 --rate 20 --latency-us 20000 --causal"},
+            {"log-2", "--workload log --nodes 2 --ops 2000 --rate 100"},
+            {"log-5-lin-kv", "--workload log --nodes 5 --ops 2000 --rate 100 --lin-kv-offsets"},
+            {"txn-2", "--workload txn --nodes 2 --ops 2000 --rate 100"},
+            {"txn-5-line", "--workload txn --nodes 5 --ops 2000 --rate 100 --topology line"},
+            {"txn-5-partition", "--workload txn --nodes 5 --ops 2000 --rate 100 --partition-at-ms 5000 --heal-at-ms 12000"},
+    };
+    return scenarios;
+}
+
+json runScenario(const std::string &sim, const Scenario &scenario) {
+    std::string command = "'" + sim + "' " + scenario.args + " --json";
+    FILE *pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        throw std::runtime_error("cannot run " + command);
+    }
+    std::string output;
+    char buffer[4096];
+    while (size_t n = fread(buffer, 1, sizeof(buffer), pipe)) {
+        output.append(buffer, n);
+    }
+    if (pclose(pipe) != 0 || output.empty()) {
+        throw std::runtime_error(scenario.name + ": " + command + " failed");
+    }
+    json report = json::parse(output);
+    report["name"] = scenario.name;
+    report["args"] = scenario.args;
+    return report;
+}
+
+// Metrics compared against a baseline, as paths into a scenario report.
+const std::vector<std::pair<std::string, json::json_pointer>> &comparedMetrics() {
+    static const std::vector<std::pair<std::string, json::json_pointer>> metrics{
+            {"msgs/op", json::json_pointer("/msgs_per_op")},
+            {"latency p50", json::json_pointer("/latency_ms/p50")},
+            {"latency max", json::json_pointer("/latency_ms/max")},
+            {"stable p50", json::json_pointer("/stable_latency_ms/p50")},
+            {"stable max", json::json_pointer("/stable_latency_ms/max")},
+            {"diverged keys", json::json_pointer("/diverged")},
+            {"throughput", json::json_pointer("/throughput")},
+            {"cpu s", json::json_pointer("/cpu_s")},
+            {"peak rss kb", json::json_pointer("/peak_rss_kb")},
+    };
+    return metrics;
+}
+
+void compare(const json &baseline, const json &current) {
+    std::cerr << std::left << std::setw(24) << "scenario" << std::setw(14) << "metric" << std::right
+              << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << std::endl;
+    for (auto &report : current["scenarios"]) {
+        const json *before = nullptr;
+        for (auto &candidate : baseline["scenarios"]) {
+            if (candidate["name"] == report["name"]) {
+                before = &candidate;
+            }
+        }
+        if (before == nullptr) {
+            continue;
+        }
+        for (auto &[metric, path] : comparedMetrics()) {
+            if (!report.contains(path) || !before->contains(path)) {
+                continue;
+            }
+            double was = (*before)[path].get<double>();
+            double now = report[path].get<double>();
+            std::cerr << std::left << std::setw(24) << report["name"].get<std::string>() << std::setw(14) << metric
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(14) << was << std::setw(14)
+                      << now << std::setw(9) << (was == 0 ? 0 : 100 * (now - was) / was) << "%" << std::endl;
+        }
+    }
+}
+
+std::string simBesideSelf(const std::string &self) {
+    auto slash = self.rfind('/');
+    return (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/flyio_sim";
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string sim = simBesideSelf(argv[0]);
+    std::string only;
+    std::string label;
+    std::string baselinePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << arg << " needs a value" << std::endl;
+            return 2;
+        }
+        if (arg == "--sim") {
+            sim = argv[++i];
+        } else if (arg == "--only") {
+            only = argv[++i];
+        } else if (arg == "--label") {
+            label = argv[++i];
+        } else if (arg == "--baseline") {
+            baselinePath = argv[++i];
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    json result = {{"label", label}, {"scenarios", json::array()}};
+    try {
+        for (auto &scenario : suite()) {
+            if (scenario.name.find(only) == std::string::npos) {
+                continue;
+            }
+            std::cerr << "running " << scenario.name << std::endl;
+            result["scenarios"].push_back(runScenario(sim, scenario));
+        }
+        if (!baselinePath.empty()) {
+            std::ifstream in(baselinePath);
+            if (!in) {
+                throw std::runtime_error("cannot read " + baselinePath);
+            }
+            compare(json::parse(in), result);
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << result.dump(2) << std::endl;
+    return 0;
+}
@@ -4,6 +4,12 @@
 
 #include "node.h"
 
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include "JsonReader.h"
+#include "JsonWriter.h"
+
 string Node::getNodeId() {
     return this->nodeId;
 }
@@ -12,132 +18,389 @@ vector<string> Node::getNodeIds() {
     return this->nodeIds;
 }
 
-int Node::newMsgId() {
-    int id = this->nextMsgId;
-    this->nextMsgId++;
+namespace {
+
+// Maelstrom clients come and go (c1, c2, ...); counting each separately would crowd out the nodes.
+string_view metricsPeer(const string &id) {
+    if (id.size() > 1 && id[0] == 'c' && all_of(id.begin() + 1, id.end(), ::isdigit)) {
+        return "clients";
+    }
     return id;
 }
 
+string_view typeOf(const json &body) {
+    auto it = body.find("type");
+    return it != body.end() && it->is_string() ? string_view(it->get_ref<const string &>()) : "unknown";
+}
+
+optional<int64_t> intField(const json &body, const char *field) {
+    auto it = body.find(field);
+    return it != body.end() && it->is_number_integer() ? optional(it->get<int64_t>()) : nullopt;
+}
+
+}
+
+int Node::newMsgId() {
+    return this->nextMsgId.fetch_add(1);
+}
+
 void Node::send(const string &dest, const json &body) {
-    json msg = {
-            {"src",  this->nodeId},
-            {"dest", dest},
-            {"body", body}
-    };
-    cerr << "Sending " << msg.dump() << endl;
-    cout << msg << endl;
-    cerr << "sent" << endl;
+    sendBody(dest, body, nullopt, nullopt);
+}
+
+void Node::sendBody(const string &dest, const json &body, optional<int64_t> msgId, optional<int64_t> inReplyTo) {
+    if (!body.is_object()) {
+        throw runtime_error("Message body must be a JSON object");
+    }
+    string line;
+    line.reserve(128);
+    JsonWriter w(line);
+    beginEnvelope(w, dest);
+    w.beginObject();
+    for (auto it = body.begin(); it != body.end(); ++it) {
+        if ((msgId && it.key() == "msg_id") || (inReplyTo && it.key() == "in_reply_to")) {
+            continue;
+        }
+        w.field(it.key(), *it);
+    }
+    if (msgId) {
+        w.field("msg_id", *msgId);
+    }
+    if (inReplyTo) {
+        w.field("in_reply_to", *inReplyTo);
+    }
+    w.endObject();
+    w.endObject();
+    finishSend(dest, typeOf(body), line, msgId ? msgId : intField(body, "msg_id"),
+               inReplyTo ? inReplyTo : intField(body, "in_reply_to"));
+}
+
+// Sends a body that is already serialized JSON, skipping the DOM round trip.
+void Node::sendRaw(const string &dest, string_view type, string_view body, optional<int64_t> msgId,
+                   optional<int64_t> inReplyTo) {
+    string line;
+    line.reserve(body.size() + nodeId.size() + dest.size() + 32);
+    JsonWriter w(line);
+    beginEnvelope(w, dest);
+    w.raw(body);
+    w.endObject();
+    finishSend(dest, type, line, msgId, inReplyTo);
+}
+
+void Node::beginEnvelope(JsonWriter &w, const string &dest) {
+    w.beginObject();
+    w.field("src", nodeId);
+    w.field("dest", dest);
+    w.key("body");
+}
+
+void Node::finishSend(const string &dest, string_view type, const string &line, optional<int64_t> msgId,
+                      optional<int64_t> inReplyTo) {
+    metrics.sent(type, metricsPeer(dest), line.size());
+    if (tracer) {
+        traceSend(dest, type, msgId, inReplyTo);
+    }
+    LOG_DEBUG("Sending ", line);
+    emit(line);
+}
+
+void Node::traceSend(const string &dest, string_view type, optional<int64_t> msgId, optional<int64_t> inReplyTo) {
+    uint64_t flow = 0;
+    if (msgId) {
+        flow = Tracer::requestFlow(nodeId, *msgId);
+    } else if (inReplyTo) {
+        flow = Tracer::replyFlow(dest, *inReplyTo);
+    }
+    auto now = scheduler->now();
+    tracer->slice(nodeId, "send " + string(type) + " to " + dest, now, now, flow, flow != 0 ? 's' : 0);
+}
+
+void Node::emit(const string &line) {
+    if (recorder) {
+        recorder->record(TrafficRecorder::Direction::Outbound, line, scheduler->now());
+    }
+    if (output) {
+        output(line);
+        return;
+    }
+    lock_guard<mutex> lock(outputMutex);
+    cout << line << endl;
 }
 
 void Node::reply(const json &req, const json &body) {
-    if (!req["body"].contains("msg_id")) {
+    auto msgId = intField(req["body"], "msg_id");
+    if (!msgId) {
         throw runtime_error("Cannot reply to a message without a msg_id");
     }
-    json body2 = body;
-    body2["in_reply_to"] = req["body"]["msg_id"];
-    send(req["src"], body2);
+    sendBody(req["src"].get_ref<const string &>(), body, nullopt, msgId);
 }
 
 json Node::rpc(const string &dest, const json &body) {
+    return rpcWith(dest, typeOf(body), [&](int msgId) {
+        sendBody(dest, body, msgId, nullopt);
+    });
+}
+
+json Node::rpcWith(const string &dest, string_view type, const function<void(int msgId)> &sendRequest) {
     int msgId = newMsgId();
-    json body2 = body;
-    body2["msg_id"] = msgId;
-    promise<json> p;
-    future<json> fut = p.get_future();
-    replyHandlers[msgId] = [&p](const json& reply) {
-        p.set_value(reply);
-    };
-    thread([this, dest, body2, msgId]() {
-        auto it = replyHandlers.find(msgId);
-        if (it != replyHandlers.end()) {
-            auto handler = it->second;
+    auto started = scheduler->now();
+    auto reply = make_shared<Scheduler::Slot>(*scheduler);
+    {
+        lock_guard<mutex> lock(replyHandlersMutex);
+        replyHandlers[msgId] = [reply](json&& r) {
+            reply->fill(move(r));
+        };
+    }
+    scheduler->runAfter(chrono::milliseconds(rpcTimeout), [this, msgId]() {
+        function<void(json&&)> handler;
+        {
+            lock_guard<mutex> lock(replyHandlersMutex);
+            auto it = replyHandlers.find(msgId);
+            if (it == replyHandlers.end()) {
+                return;
+            }
+            handler = move(it->second);
             replyHandlers.erase(it);
-
-            json err = {
-                    {"type", "error"},
-                    {"in_reply_to", msgId},
-                    {"code", 0},
-                    {"text", "RPC request timed out"}
-            };
-            handler(err);
         }
-    }).detach();
-    send(dest, body2);
-    return fut.get();
+        metrics.add(Metrics::Counter::RpcTimeouts);
+        if (tracer) {
+            auto now = scheduler->now();
+            tracer->slice(nodeId, "rpc timeout", now, now);
+        }
+
+        json err = {
+                {"type", "error"},
+                {"in_reply_to", msgId},
+                {"code", 0},
+                {"text", "RPC request timed out"}
+        };
+        handler(move(err));
+    });
+    sendRequest(msgId);
+    json r = reply->take();
+    auto finished = scheduler->now();
+    statsFor(string(type)).rpc.record(finished - started);
+    if (tracer) {
+        tracer->slice(nodeId, "rpc " + string(type) + " to " + dest, started, finished);
+    }
+    return r;
 }
 
+// Retries until the request does not time out; other error replies are returned to the caller.
 json Node::retryRPC(const string &dest, const json &body) {
     while (true) {
         try {
-            return rpc(dest, body);
+            json reply = rpc(dest, body);
+            if (reply["type"] != "error" || reply["code"] != 0) {
+                return reply;
+            }
         } catch (...) {
-            cerr << "Retrying RPC request to " << dest << " " << body.dump() << endl;
         }
+        metrics.add(Metrics::Counter::RpcRetries);
+        LOG_INFO("Retrying RPC request to ", dest, " ", body);
+    }
+}
+
+void Node::on(const string &type, function<void(const json&)> handler) {
+    handlers[type] = move(handler);
+    // a typed handler registered for the type earlier is replaced too (see on<T>)
+    rawHandlers.erase(type);
+    if (!messageStats.contains(type)) {
+        messageStats[type] = make_unique<MessageStats>();
+    }
+}
+
+MessageStats &Node::statsFor(const string &type) {
+    auto it = messageStats.find(type);
+    if (it != messageStats.end()) {
+        return *it->second;
     }
+    lock_guard<mutex> lock(otherStatsMutex);
+    auto &stats = otherStats[type];
+    if (!stats) {
+        stats = make_unique<MessageStats>();
+    }
+    return *stats;
 }
 
-void Node::on(const string &type, const function<void(json)> &handler) {
-    handlers[type] = handler;
+namespace {
+
+json histogramJson(const LatencyHistogram &histogram) {
+    LatencyHistogram::Snapshot snap = histogram.snapshot();
+    return {{"count", snap.count}, {"p50", snap.valueAt(0.5)}, {"p99", snap.valueAt(0.99)},
+            {"p999", snap.valueAt(0.999)}, {"max", snap.max}};
+}
+
+void addStats(json &out, const string &type, const MessageStats &stats) {
+    json entry = json::object();
+    for (auto [name, histogram] : {pair{"queue_us", &stats.queue}, pair{"handler_us", &stats.handler}, pair{"rpc_us", &stats.rpc}}) {
+        json h = histogramJson(*histogram);
+        if (h["count"] != 0) {
+            entry[name] = move(h);
+        }
+    }
+    if (!entry.empty()) {
+        out[type] = move(entry);
+    }
+}
+
+}
+
+json Node::statsJson() {
+    json out = json::object();
+    for (auto &[type, stats] : messageStats) {
+        addStats(out, type, *stats);
+    }
+    addStats(out, "replies", replyStats);
+    lock_guard<mutex> lock(otherStatsMutex);
+    for (auto &[type, stats] : otherStats) {
+        addStats(out, type, *stats);
+    }
+    return out;
 }
 
 void Node::handleInit(const json &req) {
     this->nodeId = req["body"]["node_id"];
     this->nodeIds = req["body"]["node_ids"].get<vector<string>>();
-    cerr << "init: " << req << endl;
-    cerr << "Node " << nodeId << " initialized" << endl;
+    this->nodeIndex = NodeIndex(this->nodeIds);
+    LOG_DEBUG("init: ", req);
+    LOG_INFO("Node ", nodeId, " initialized");
 }
 
 void Node::maybeReplyError(const json &req, const exception &e) {
-    if (req["body"].contains("msg_id")) {
+    replyError(req["src"], msgIdOf(req["body"]), e);
+}
+
+void Node::replyError(const string &src, optional<int64_t> msgId, const exception &e) {
+    if (msgId) {
         json err = {
                 {"type", "error"},
                 {"code", 13},
                 {"text", string(e.what())}
         };
-        reply(req, err);
+        sendBody(src, err, nullopt, msgId);
     }
 }
 
+json Node::metricsJson() const {
+    Metrics::Snapshot snap = metrics.snapshot();
+    auto inOut = [](const map<string, Metrics::InOut> &counts) {
+        json out = json::object();
+        for (auto &[key, c] : counts) {
+            out[key] = {{"in", c.in}, {"out", c.out}};
+        }
+        return out;
+    };
+    return {
+            {"messages_in", snap.messagesIn},
+            {"messages_out", snap.messagesOut},
+            {"bytes_in", snap[Metrics::Counter::BytesIn]},
+            {"bytes_out", snap[Metrics::Counter::BytesOut]},
+            {"rpc_retries", snap[Metrics::Counter::RpcRetries]},
+            {"rpc_timeouts", snap[Metrics::Counter::RpcTimeouts]},
+            {"dropped_replies", snap[Metrics::Counter::DroppedReplies]},
+            {"by_type", inOut(snap.byType)},
+            {"by_peer", inOut(snap.byPeer)}
+    };
+}
+
+void Node::countInbound(const json &req, size_t bytes) {
+    metrics.received(typeOf(req["body"]), metricsPeer(req["src"].get_ref<const string &>()), bytes);
+}
+
+optional<int64_t> Node::msgIdOf(const json &body) {
+    return intField(body, "msg_id");
+}
+
 void Node::handle(const json &req) {
+    handle(req, scheduler->now());
+}
+
+void Node::handle(json &&req) {
+    handle(move(req), scheduler->now());
+}
+
+void Node::handle(const json &req, Scheduler::Clock::time_point received) {
+    const json &body = req["body"];
+    if (body.contains("in_reply_to")) {
+        // the waiting RPC takes the body, so a caller that keeps its message pays for one copy here
+        handleReply(json(body), received);
+        return;
+    }
+    handleRequest(req, received);
+}
+
+void Node::handle(json &&req, Scheduler::Clock::time_point received) {
+    json &body = req["body"];
+    if (body.contains("in_reply_to")) {
+        handleReply(move(body), received);
+        return;
+    }
+    handleRequest(req, received);
+}
+
+void Node::handleReply(json &&body, Scheduler::Clock::time_point received) {
     try {
-        json body = req["body"];
-        if (body.contains("in_reply_to")) {
-            int in_reply_to = body["in_reply_to"];
-            if (replyHandlers.count(in_reply_to) > 0) {
-                auto handler = replyHandlers[in_reply_to];
-                replyHandlers.erase(in_reply_to);
-                if (body["type"] == "error") {
-                    json err = {
-                            {"type", "error"},
-                            {"code", body["code"]},
-                            {"text", body["text"]}
-                    };
-                    handler(err);
-                } else {
-                    handler(body);
-                }
+        replyStats.queue.record(scheduler->now() - received);
+        int in_reply_to = body["in_reply_to"];
+        if (tracer) {
+            tracer->slice(nodeId, "reply " + string(typeOf(body)), received, scheduler->now(),
+                          Tracer::replyFlow(nodeId, in_reply_to), 'f');
+        }
+        function<void(json&&)> handler;
+        {
+            lock_guard<mutex> lock(replyHandlersMutex);
+            auto it = replyHandlers.find(in_reply_to);
+            if (it != replyHandlers.end()) {
+                handler = move(it->second);
+                replyHandlers.erase(it);
             }
+        }
+        if (!handler) {
+            // its RPC already timed out
+            metrics.add(Metrics::Counter::DroppedReplies);
             return;
         }
+        if (body["type"] == "error") {
+            json err = {
+                    {"type", "error"},
+                    {"code", move(body["code"])},
+                    {"text", move(body["text"])}
+            };
+            handler(move(err));
+        } else {
+            handler(move(body));
+        }
+    } catch (exception& e) {
+        LOG_ERROR("Error processing reply ", e.what());
+    }
+}
 
+void Node::handleRequest(const json &req, Scheduler::Clock::time_point received) {
+    try {
+        const json &body = req["body"];
         string type = body["type"];
         if (type == "init") {
-            cerr << "init called" << endl;
-
             handleInit(req);
-            auto handler = handlers["init"];
-            if (handler) {
-                handler(req);
+            auto init = handlers.find("init");
+            if (init != handlers.end()) {
+                init->second(req);
             }
             reply(req, {{"type", "init_ok"}});
             return;
         }
+        if (type == "stats") {
+            reply(req, {{"type", "stats_ok"}, {"stats", statsJson()}, {"metrics", metricsJson()}});
+            return;
+        }
 
-        if (handlers.count(type) > 0) {
-            auto handler = handlers[type];
-            handler(req);
+        auto handler = handlers.find(type);
+        if (handler != handlers.end()) {
+            dispatch(type, req["src"].get_ref<const string &>(), msgIdOf(body), received, [&] {
+                handler->second(req);
+            });
         } else {
-            cerr << "Don't know how to handle msg type " << type << " (" << req.dump() << ")" << endl;
+            LOG_WARN("Don't know how to handle msg type ", type, " (", req, ")");
             reply(req, {
                     {"type", "error"},
                     {"code", 10},
@@ -145,22 +408,107 @@ void Node::handle(const json &req) {
             });
         }
     } catch (exception& e) {
-        cerr << "Error processing request " << e.what() << endl;
+        LOG_ERROR("Error processing request ", e.what());
         maybeReplyError(req, e);
     }
 }
 
+void Node::dispatch(const string &type, const string &src, optional<int64_t> msgId,
+                    Scheduler::Clock::time_point received, const function<void()> &call) {
+    MessageStats &stats = statsFor(type);
+    auto started = scheduler->now();
+    stats.queue.record(started - received);
+    call();
+    auto finished = scheduler->now();
+    stats.handler.record(finished - started);
+    if (tracer) {
+        tracer->slice(nodeId, "queued " + type, received, started,
+                      msgId ? Tracer::requestFlow(src, *msgId) : 0, msgId ? 'f' : 0);
+        tracer->slice(nodeId, "handle " + type, started, finished);
+    }
+}
+
+void Node::handleLine(const string &line, Scheduler::Clock::time_point received) {
+    // just enough of the envelope to pick the handler; a typed one decodes the body itself
+    string src;
+    string type;
+    optional<int64_t> msgId;
+    bool isReply = false;
+    try {
+        string_view body;
+        JsonReader envelope(line);
+        envelope.beginObject();
+        while (auto key = envelope.nextKey()) {
+            if (*key == "src") {
+                src = envelope.readString();
+            } else if (*key == "body") {
+                body = envelope.skipValue();
+            } else {
+                envelope.skipValue();
+            }
+        }
+        envelope.expectEnd();
+        JsonReader fields(body);
+        fields.beginObject();
+        while (auto key = fields.nextKey()) {
+            if (*key == "type" && fields.peek() == JsonReader::Kind::String) {
+                type = fields.readString();
+            } else if (*key == "msg_id" && fields.peek() == JsonReader::Kind::Number) {
+                msgId = fields.readInt();
+            } else {
+                isReply = isReply || *key == "in_reply_to";
+                fields.skipValue();
+            }
+        }
+
+        auto raw = isReply ? rawHandlers.end() : rawHandlers.find(type);
+        if (raw != rawHandlers.end()) {
+            metrics.received(type, metricsPeer(src), line.size());
+            dispatch(type, src, msgId, received, [&] {
+                raw->second(src, msgId, body);
+            });
+            return;
+        }
+    } catch (exception &e) {
+        LOG_ERROR("Error processing request ", e.what());
+        replyError(src, msgId, e);
+        return;
+    }
+
+    json req = json::parse(line, nullptr, false);
+    if (req.is_discarded()) {
+        LOG_ERROR("Dropping malformed message ", line);
+        return;
+    }
+    countInbound(req, line.size());
+    handle(move(req), received);
+}
+
 [[noreturn]] void Node::run() {
     while (true) {
         string line;
-        getline(cin, line);
+        if (!getline(cin, line)) {
+            // the harness closed stdin; exit once the requests already read are handled
+            while (activeHandlers.load() > 0) {
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+            if (tracer) {
+                tracer->dump();
+            }
+            Log::flush();
+            quick_exit(0);
+        }
         if (line.empty()) {
             continue;
         }
-        json req = json::parse(line);
-        thread handler_thread([this, req]() {
-            this->handle(req);
+        auto received = scheduler->now();
+        if (recorder) {
+            recorder->record(TrafficRecorder::Direction::Inbound, line, received);
+        }
+        activeHandlers++;
+        scheduler->spawn([this, line = move(line), received]() {
+            this->handleLine(line, received);
+            activeHandlers--;
         });
-        handler_thread.detach();
     }
 }
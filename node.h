@@ -9,6 +9,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <chrono>
@@ -22,7 +23,18 @@
 #include <queue>
 #include <future>
 #include <random>
+#include <atomic>
+#include <optional>
 #include "TreeNode.h"
+#include "NodeIndex.h"
+#include "JsonWriter.h"
+#include "LatencyHistogram.h"
+#include "Log.h"
+#include "MessageSchema.h"
+#include "Metrics.h"
+#include "Scheduler.h"
+#include "Tracer.h"
+#include "TrafficRecorder.h"
 
 using json = nlohmann::json;
 using namespace std;
@@ -41,37 +53,179 @@ struct Message {
     InjectedPayload payload;
 };
 
+// Latencies for one message type, in scheduler time; returned by the built-in "stats" message.
+struct MessageStats {
+    // from the line being read until its handler starts
+    LatencyHistogram queue;
+    LatencyHistogram handler;
+    // from sending an RPC of this type until its reply or timeout
+    LatencyHistogram rpc;
+};
+
+// A request whose body was decoded into T, as handlers registered with Node::on<T>() get it.
+template<typename T>
+struct Request {
+    string src;
+    optional<int64_t> msgId;
+    T body;
+};
+
 class Node {
 public:
     string nodeId;
     vector<string> nodeIds;
+    NodeIndex nodeIndex;
     int rpcTimeout = 100;
-    int nextMsgId = 0;
-    map<int, function<void(json)>> replyHandlers;
+    // sleeps, RPC timeouts and handler threads; replace before registering handlers
+    Scheduler *scheduler = &Scheduler::realTime();
+    atomic<int> nextMsgId{0};
+    // handlers run() has started that have not returned yet
+    atomic<int> activeHandlers{0};
+    // waiting RPCs by msg_id; the reply body is moved into the callback
+    map<int, function<void(json&&)>> replyHandlers;
     mutex replyHandlersMutex;
-    unordered_map<string, function<void(json)>> handlers;
-
-    set<string> messages;
+    // handlers run on their own threads; keeps outbound lines from interleaving on stdout
+    mutex outputMutex;
+    // by message type; a handler gets the request by reference, valid for the duration of the call
+    unordered_map<string, function<void(const json&)>> handlers;
+    // the typed handlers among them (see on<T>), given the body's text from the line run() read; the
+    // src and body views last for the duration of the call
+    unordered_map<string, function<void(const string& src, optional<int64_t> msgId, string_view body)>> rawHandlers;
+    // one per handler type, added by on() and read without locking once messages flow
+    unordered_map<string, unique_ptr<MessageStats>> messageStats;
+    // replies to this node's RPCs, whatever their type
+    MessageStats replyStats;
+    // anything else: RPC types with no handler here, unknown messages
+    mutex otherStatsMutex;
+    unordered_map<string, unique_ptr<MessageStats>> otherStats;
+    // message, byte and RPC counters; Maelstrom clients are counted together as "clients"
+    Metrics metrics;
+    // when set, outbound lines go here instead of stdout (the in-process simulator wires nodes together this way)
+    function<void(const string&)> output;
+    // when set, every line read in run() and every line emitted is copied here (see flyio_replay)
+    shared_ptr<TrafficRecorder> recorder;
+    // when set, handler runs, sends, RPCs and timeouts are traced here
+    shared_ptr<Tracer> tracer;
+
+    // guards messages, peers, neighbours and peerMessages; broadcast handlers run concurrently
+    mutex messagesMutex;
+    set<int64_t> messages;
     set<string> peers;
+    // every node's neighbours as the topology message lists them, so gossip can skip the sender's own
+    unordered_map<string, set<string>> neighbours;
     // map of peer_id -> set of messages that I know that it knows
-    unordered_map<string, set<string>> peerMessages;
+    unordered_map<string, set<int64_t>> peerMessages;
+    // when set, called with each broadcast value as it becomes readable here (the simulator times stable
+    // latency with it rather than polling reads)
+    function<void(int64_t)> onBroadcastReadable;
 
     Node() = default;
     string getNodeId();
     vector<string> getNodeIds();
     int newMsgId();
     void send(const string& nodeId, const json& msg);
+    // Writes the envelope and body straight into the outbound line. msgId and inReplyTo, when given,
+    // are written into the body after its own fields, in place of any the body has.
+    void sendBody(const string& dest, const json& body, optional<int64_t> msgId, optional<int64_t> inReplyTo);
+    template<schema::Message T>
+    void send(const string& dest, const T& body, optional<int64_t> msgId = nullopt, optional<int64_t> inReplyTo = nullopt);
+    // Sends a body that is already serialized JSON. The caller wrote type, msg_id and in_reply_to into it
+    // and passes them again for metrics and tracing, so the body is never scanned.
+    void sendRaw(const string& dest, string_view type, string_view body, optional<int64_t> msgId,
+                 optional<int64_t> inReplyTo);
+    // Starts an outbound line: {"src":..,"dest":..,"body": with the body to follow.
+    void beginEnvelope(JsonWriter& w, const string& dest);
+    // Counts, traces and emits a finished outbound line.
+    void finishSend(const string& dest, string_view type, const string& line, optional<int64_t> msgId, optional<int64_t> inReplyTo);
+    void emit(const string& line);
+    void traceSend(const string& dest, string_view type, optional<int64_t> msgId, optional<int64_t> inReplyTo);
     void reply(const json& req, const json& body);
+    template<typename T, schema::Message R>
+    void reply(const Request<T>& req, const R& body);
+    template<typename T>
+    void reply(const Request<T>& req, const json& body);
     json rpc(const string& dest, const json& body);
+    template<schema::Message T>
+    json rpc(const string& dest, const T& body);
+    // Sends one RPC through sendRequest, which is given the msg_id to use, and waits for its reply.
+    json rpcWith(const string& dest, string_view type, const function<void(int msgId)>& sendRequest);
     json retryRPC(const string& dest, const json& body);
-    void on(const string& type, const function<void(json)>& handler);
+    void on(const string& type, function<void(const json&)> handler);
+    // Registers a handler for T::type that gets the body decoded into T. Lines read by run() are decoded
+    // straight from their text; requests handed to handle() already parsed (the simulator) from the DOM.
+    template<schema::Message T>
+    void on(function<void(const Request<T>&)> handler);
     void handleInit(const json& req);
     void maybeReplyError(const json& req, const exception& e);
+    void replyError(const string& src, optional<int64_t> msgId, const exception& e);
+    // The rvalue overloads let a reply body move on to its waiting RPC; requests are never copied.
     void handle(const json& req);
+    void handle(json&& req);
+    void handle(const json& req, Scheduler::Clock::time_point received);
+    void handle(json&& req, Scheduler::Clock::time_point received);
+    void handleReply(json&& body, Scheduler::Clock::time_point received);
+    void handleRequest(const json& req, Scheduler::Clock::time_point received);
+    // Handles a line as read off the wire: typed handlers decode it in place, the rest parse it to json first.
+    void handleLine(const string& line, Scheduler::Clock::time_point received);
+    // Runs a registered handler, recording its queue and handler latencies and tracing both.
+    void dispatch(const string& type, const string& src, optional<int64_t> msgId, Scheduler::Clock::time_point received,
+                  const function<void()>& call);
+    MessageStats &statsFor(const string& type);
+    json statsJson();
+    json metricsJson() const;
+    // Counts a message read off the wire; whoever reads lines calls this (run(), the simulator).
+    void countInbound(const json& req, size_t bytes);
+    static optional<int64_t> msgIdOf(const json& body);
 
     [[noreturn]] void run();
 };
 
+template<schema::Message T>
+void Node::send(const string &dest, const T &body, optional<int64_t> msgId, optional<int64_t> inReplyTo) {
+    string line;
+    line.reserve(128);
+    JsonWriter w(line);
+    beginEnvelope(w, dest);
+    schema::write(w, body, msgId, inReplyTo);
+    w.endObject();
+    finishSend(dest, T::type, line, msgId, inReplyTo);
+}
+
+template<typename T, schema::Message R>
+void Node::reply(const Request<T> &req, const R &body) {
+    if (!req.msgId) {
+        throw runtime_error("Cannot reply to a message without a msg_id");
+    }
+    send(req.src, body, nullopt, req.msgId);
+}
+
+template<typename T>
+void Node::reply(const Request<T> &req, const json &body) {
+    if (!req.msgId) {
+        throw runtime_error("Cannot reply to a message without a msg_id");
+    }
+    sendBody(req.src, body, nullopt, req.msgId);
+}
+
+template<schema::Message T>
+json Node::rpc(const string &dest, const T &body) {
+    return rpcWith(dest, T::type, [&](int msgId) {
+        send(dest, body, msgId);
+    });
+}
+
+template<schema::Message T>
+void Node::on(function<void(const Request<T>&)> handler) {
+    string type(T::type);
+    on(type, [handler](const json &req) {
+        const json &body = req["body"];
+        handler(Request<T>{req["src"].get_ref<const string &>(), msgIdOf(body), schema::fromJson<T>(body)});
+    });
+    rawHandlers[type] = [handler = move(handler)](const string &src, optional<int64_t> msgId, string_view body) {
+        handler(Request<T>{src, msgId, schema::parse<T>(body)});
+    };
+}
+
 
 #endif //FLYIO_CHALLENGES_NODE_H
 
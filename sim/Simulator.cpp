@@ -0,0 +1,234 @@
+#include "Simulator.h"
+
+#include "JsonReader.h"
+
+namespace {
+
+// src and dest of a line a node wrote; Node puts both ahead of the body, so the body is never scanned.
+pair<string, string> endpointsOf(string_view line) {
+    pair<string, string> endpoints;
+    auto &[src, dest] = endpoints;
+    JsonReader r(line);
+    r.beginObject();
+    while (auto key = r.nextKey()) {
+        if (*key == "src") {
+            src = r.readString();
+        } else if (*key == "dest") {
+            dest = r.readString();
+        } else {
+            r.skipValue();
+        }
+        if (!src.empty() && !dest.empty()) {
+            break;
+        }
+    }
+    return endpoints;
+}
+
+}
+
+Simulator::Simulator(size_t nodeCount, LinkConfig link, uint64_t seed, const ServiceOptions &options)
+        : link(link), rng(seed) {
+    for (size_t i = 0; i < nodeCount; i++) {
+        ids.push_back("n" + to_string(i));
+    }
+    for (auto &id : ids) {
+        auto sim = make_unique<SimNode>();
+        sim->node.scheduler = &clock;
+        sim->node.output = [this](const string &line) {
+            auto [src, dest] = endpointsOf(line);
+            submit(src, dest, line);
+        };
+        byId[id] = &sim->node;
+        nodes.push_back(move(sim));
+    }
+    run([this, &options]() {
+        for (auto &sim : nodes) {
+            sim->services.registerHandlers(sim->node, options);
+        }
+        for (auto &id : ids) {
+            // init skips the network so every node is up before the first client request
+            byId[id]->handle({{"src", "c0"}, {"dest", id},
+                              {"body", {{"type", "init"}, {"msg_id", 0}, {"node_id", id}, {"node_ids", ids}}}});
+        }
+    });
+}
+
+void Simulator::run(const function<void()> &body) {
+    bool done = false;
+    clock.spawn([&body, &done]() {
+        body();
+        done = true;
+    });
+    clock.runUntil([&done]() {
+        return done;
+    });
+    if (!done) {
+        throw logic_error("simulation stalled: nothing left to run before the body finished");
+    }
+}
+
+bool Simulator::isNode(const string &id) const {
+    return byId.contains(id);
+}
+
+void Simulator::submit(const json &msg) {
+    submit(msg["src"].get_ref<const string &>(), msg["dest"].get_ref<const string &>(), msg.dump());
+}
+
+void Simulator::submit(const string &src, const string &dest, string line) {
+    chrono::microseconds delay = link.latency;
+    {
+        lock_guard<mutex> lock(networkMutex);
+        if (isNode(src) && isNode(dest)) {
+            if (!groupOf.empty()) {
+                auto a = groupOf.find(src), b = groupOf.find(dest);
+                if (a == groupOf.end() || b == groupOf.end() || a->second != b->second) {
+                    counters.dropped++;
+                    return;
+                }
+            }
+            if (link.loss > 0 && uniform_real_distribution<double>(0, 1)(rng) < link.loss) {
+                counters.dropped++;
+                return;
+            }
+            counters.nodeMessages++;
+        } else if (src == "lin-kv" || dest == "lin-kv") {
+            counters.serviceMessages++;
+        } else {
+            counters.clientMessages++;
+        }
+        if (link.jitter.count() > 0) {
+            delay += chrono::microseconds(uniform_int_distribution<int64_t>(0, link.jitter.count())(rng));
+        }
+    }
+    clock.runAfter(delay, [this, dest, line = move(line)]() mutable {
+        deliver(dest, move(line));
+    });
+}
+
+void Simulator::deliver(const string &dest, string &&line) {
+    auto node = byId.find(dest);
+    if (node != byId.end()) {
+        // nodes get the line as a real one reads it off stdin
+        clock.spawn([n = node->second, line = move(line), received = clock.now()]() {
+            n->handleLine(line, received);
+        });
+        return;
+    }
+    json msg = json::parse(line);
+    if (dest == "lin-kv") {
+        serveLinKv(msg);
+        return;
+    }
+    json &body = msg["body"];
+    if (!body.contains("in_reply_to")) {
+        return;
+    }
+    shared_ptr<Scheduler::Slot> slot;
+    {
+        lock_guard<mutex> lock(callsMutex);
+        auto it = calls.find(body["in_reply_to"].get<int>());
+        if (it == calls.end()) {
+            return;
+        }
+        slot = move(it->second);
+        calls.erase(it);
+    }
+    slot->fill(move(body));
+}
+
+void Simulator::serveLinKv(const json &req) {
+    const json &body = req["body"];
+    json reply = {{"in_reply_to", body["msg_id"]}};
+    {
+        lock_guard<mutex> lock(kvMutex);
+        string key = body["key"].is_string() ? body["key"].get<string>() : body["key"].dump();
+        auto it = kv.find(key);
+        if (body["type"] == "read") {
+            if (it == kv.end()) {
+                reply.update({{"type", "error"}, {"code", 20}, {"text", "key does not exist"}});
+            } else {
+                reply.update({{"type", "read_ok"}, {"value", it->second}});
+            }
+        } else if (body["type"] == "write") {
+            kv[key] = body["value"];
+            reply["type"] = "write_ok";
+        } else if (body["type"] == "cas") {
+            if (it == kv.end() && !body.value("create_if_not_exists", false)) {
+                reply.update({{"type", "error"}, {"code", 20}, {"text", "key does not exist"}});
+            } else if (it != kv.end() && it->second != body["from"]) {
+                reply.update({{"type", "error"}, {"code", 22}, {"text", "current value does not match from"}});
+            } else {
+                kv[key] = body["to"];
+                reply["type"] = "cas_ok";
+            }
+        } else {
+            reply.update({{"type", "error"}, {"code", 10}, {"text", "unsupported request type"}});
+        }
+    }
+    submit({{"src", "lin-kv"}, {"dest", req["src"]}, {"body", reply}});
+}
+
+optional<json> Simulator::call(const string &client, const string &dest, json body, chrono::milliseconds timeout) {
+    int id = nextCallId++;
+    auto reply = make_shared<Scheduler::Slot>(clock);
+    {
+        lock_guard<mutex> lock(callsMutex);
+        calls[id] = reply;
+    }
+    body["msg_id"] = id;
+    submit({{"src", client}, {"dest", dest}, {"body", move(body)}});
+    clock.runAfter(timeout, [this, id]() {
+        shared_ptr<Scheduler::Slot> slot;
+        {
+            lock_guard<mutex> lock(callsMutex);
+            auto it = calls.find(id);
+            if (it == calls.end()) {
+                return;
+            }
+            slot = move(it->second);
+            calls.erase(it);
+        }
+        slot->fill(nullptr);
+    });
+    json r = reply->take();
+    if (r.is_null()) {
+        return nullopt;
+    }
+    return r;
+}
+
+void Simulator::partition(const vector<vector<string>> &groups) {
+    lock_guard<mutex> lock(networkMutex);
+    groupOf.clear();
+    for (size_t g = 0; g < groups.size(); g++) {
+        for (auto &id : groups[g]) {
+            groupOf[id] = static_cast<int>(g);
+        }
+    }
+}
+
+void Simulator::heal() {
+    lock_guard<mutex> lock(networkMutex);
+    groupOf.clear();
+}
+
+void Simulator::trace(const shared_ptr<Tracer> &tracer) {
+    for (auto &sim : nodes) {
+        sim->node.tracer = tracer;
+    }
+}
+
+Simulator::Stats Simulator::stats() const {
+    lock_guard<mutex> lock(networkMutex);
+    return counters;
+}
+
+void Simulator::observeBroadcasts(const function<void(size_t, int64_t)> &observer) {
+    for (size_t k = 0; k < nodes.size(); k++) {
+        nodes[k]->node.onBroadcastReadable = [observer, k](int64_t message) {
+            observer(k, message);
+        };
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef FLYIO_CHALLENGES_SIMULATOR_H
+#define FLYIO_CHALLENGES_SIMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.h"
+#include "NodeServices.h"
+#include "VirtualScheduler.h"
+
+// Delay and loss applied to every node-to-node message. Client and lin-kv traffic gets the same
+// delay but is never dropped or partitioned away, like Maelstrom's own clients and services.
+struct LinkConfig {
+    chrono::microseconds latency{1000};
+    // each message gets an extra uniform delay in [0, jitter]
+    chrono::microseconds jitter{0};
+    // probability that a node-to-node message is dropped
+    double loss = 0;
+};
+
+// In-process stand-in for the Maelstrom harness: N Nodes running the real NodeServices handlers,
+// whose output lines are routed to each other through simulated links instead of stdio.
+// Everything runs on one VirtualScheduler: a message in flight is a timer due when its link delay
+// has passed, and every delay/loss decision is drawn from a seeded generator, so a seed replays the
+// same run, and simulated seconds cost only the CPU work done in them.
+// call(), partition() and heal() must run as scheduler participants; run() starts one from outside.
+// Nodes keep timers and parked participants alive forever, so a Simulator lives until the process exits.
+class Simulator {
+public:
+    struct Stats {
+        uint64_t nodeMessages = 0;
+        uint64_t clientMessages = 0;
+        uint64_t serviceMessages = 0;
+        uint64_t dropped = 0;
+    };
+
+    Simulator(size_t nodeCount, LinkConfig link, uint64_t seed, const ServiceOptions &options);
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    [[nodiscard]] const vector<string> &nodeIds() const { return ids; }
+    VirtualScheduler &scheduler() { return clock; }
+    // Runs body as a participant, driving the scheduler on the calling thread until body returns.
+    void run(const function<void()> &body);
+    // Sends a request from `client` to `dest` and waits for the reply body; nullopt if none arrives in time.
+    optional<json> call(const string &client, const string &dest, json body, chrono::milliseconds timeout);
+    // Cuts node-to-node links between groups; nodes left out of every group are isolated.
+    void partition(const vector<vector<string>> &groups);
+    void heal();
+    [[nodiscard]] Stats stats() const;
+    // Calls observer(node index, value) whenever a broadcast value becomes readable on a node.
+    void observeBroadcasts(const function<void(size_t, int64_t)> &observer);
+    // Traces every node into one file.
+    void trace(const shared_ptr<Tracer> &tracer);
+
+private:
+    struct SimNode {
+        Node node;
+        NodeServices services;
+    };
+
+    VirtualScheduler clock;
+    vector<string> ids;
+    vector<unique_ptr<SimNode>> nodes;
+    unordered_map<string, Node *> byId;
+    LinkConfig link;
+
+    mutable mutex networkMutex;
+    mt19937_64 rng;
+    // node -> partition group; empty when the network is whole
+    unordered_map<string, int> groupOf;
+    Stats counters;
+
+    mutex callsMutex;
+    unordered_map<int, shared_ptr<Scheduler::Slot>> calls;
+    atomic<int> nextCallId{0};
+
+    mutex kvMutex;
+    unordered_map<string, json> kv;
+
+    // Carries a line from src to dest across the simulated network; node output arrives as written and
+    // reaches nodes through Node::handleLine, so no DOM is built for node-to-node traffic.
+    void submit(const string &src, const string &dest, string line);
+    // A message the simulator makes up itself: client requests and lin-kv replies.
+    void submit(const json &msg);
+    void deliver(const string &dest, string &&line);
+    void serveLinKv(const json &req);
+    [[nodiscard]] bool isNode(const string &id) const;
+};
+
+#endif //FLYIO_CHALLENGES_SIMULATOR_H
@@ -0,0 +1,185 @@
+#include "VirtualScheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define FLYIO_FIBER_SWITCH_X86_64 1
+
+// Pushes the callee-saved registers and the SSE/x87 control words, stores the stack pointer in *save, then
+// pops the same frame off restore and returns into whatever pushed it.
+extern "C" void flyioSwitchStack(void **save, void *restore);
+asm(R"(
+    .text
+    .globl flyioSwitchStack
+    .type flyioSwitchStack, @function
+flyioSwitchStack:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size flyioSwitchStack, .-flyioSwitchStack
+)");
+#endif
+
+namespace {
+
+// the scheduler inside runUntil() on this thread; makecontext entry points take no arguments worth using
+thread_local VirtualScheduler *driving = nullptr;
+
+size_t pageSize() {
+    static const auto size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+}
+
+VirtualScheduler::Fiber::Fiber() {
+    size_t guard = pageSize();
+    mapping = mmap(nullptr, guard + StackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                   -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mmap fiber stack");
+    }
+    // stacks grow down, so the guard goes at the low end
+    mprotect(mapping, guard, PROT_NONE);
+#ifdef FLYIO_FIBER_SWITCH_X86_64
+    // The frame flyioSwitchStack pops on the first switch in: default control words, zeroed registers, then
+    // fiberMain as the return address, entered as if called (with a null return address of its own).
+    auto *top = reinterpret_cast<uint64_t *>(static_cast<char *>(mapping) + guard + StackSize);
+    uint64_t *frame = top - 9;
+    std::fill(frame, top, 0);
+    frame[0] = 0x1F80 | (uint64_t{0x037F} << 32);
+    frame[7] = reinterpret_cast<uint64_t>(&fiberMain);
+    context.stackPointer = frame;
+#else
+    getcontext(&context.fallback);
+    context.fallback.uc_stack.ss_sp = static_cast<char *>(mapping) + guard;
+    context.fallback.uc_stack.ss_size = StackSize;
+    context.fallback.uc_link = nullptr;
+    makecontext(&context.fallback, fiberMain, 0);
+#endif
+}
+
+VirtualScheduler::Fiber::~Fiber() {
+    munmap(mapping, pageSize() + StackSize);
+}
+
+Scheduler::Clock::time_point VirtualScheduler::now() {
+    return time;
+}
+
+std::chrono::system_clock::time_point VirtualScheduler::wallTime() {
+    return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(now().time_since_epoch()));
+}
+
+void VirtualScheduler::runUntil(const std::function<bool()> &done) {
+    VirtualScheduler *outer = driving;
+    driving = this;
+    while (!done()) {
+        if (!runnable.empty()) {
+            running = runnable.front();
+            runnable.pop_front();
+            switchContext(driver, running->context);
+            running = nullptr;
+            continue;
+        }
+        if (timers.empty()) {
+            break;
+        }
+        // moving out of the top is safe: pop() only compares due and seq, which a move leaves intact
+        Timer timer = std::move(const_cast<Timer &>(timers.top()));
+        timers.pop();
+        time = std::max(time, timer.due);
+        timer.task();
+    }
+    driving = outer;
+}
+
+void VirtualScheduler::fiberMain() {
+    VirtualScheduler *self = driving;
+    Fiber *fiber = self->running;
+    while (true) {
+        fiber->task();
+        fiber->task = nullptr;
+        self->idle.push_back(fiber);
+        switchContext(fiber->context, self->driver);
+    }
+}
+
+void VirtualScheduler::switchContext(Context &from, Context &to) {
+#ifdef FLYIO_FIBER_SWITCH_X86_64
+    flyioSwitchStack(&from.stackPointer, to.stackPointer);
+#else
+    swapcontext(&from.fallback, &to.fallback);
+#endif
+}
+
+void VirtualScheduler::park(Parked &p) {
+    if (p.resumed) {
+        // resumed before it got here
+        p.resumed = false;
+        return;
+    }
+    if (running == nullptr) {
+        throw std::logic_error("park() outside a participant");
+    }
+    Fiber *self = running;
+    p.participant = self;
+    switchContext(self->context, driver);
+}
+
+void VirtualScheduler::resume(Parked &p) {
+    if (p.participant == nullptr) {
+        p.resumed = true;
+        return;
+    }
+    runnable.push_back(static_cast<Fiber *>(p.participant));
+    p.participant = nullptr;
+}
+
+void VirtualScheduler::sleepFor(Clock::duration d) {
+    Parked p;
+    runAfter(d, [this, &p]() {
+        resume(p);
+    });
+    park(p);
+}
+
+void VirtualScheduler::runAfter(Clock::duration d, std::function<void()> task) {
+    timers.push({time + d, nextSeq++, std::move(task)});
+}
+
+void VirtualScheduler::spawn(std::function<void()> task) {
+    Fiber *fiber;
+    if (!idle.empty()) {
+        fiber = idle.back();
+        idle.pop_back();
+    } else {
+        fibers.push_back(std::make_unique<Fiber>());
+        fiber = fibers.back().get();
+    }
+    fiber->task = std::move(task);
+    runnable.push_back(fiber);
+}
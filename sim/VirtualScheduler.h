@@ -0,0 +1,94 @@
+#ifndef FLYIO_CHALLENGES_VIRTUALSCHEDULER_H
+#define FLYIO_CHALLENGES_VIRTUALSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <ucontext.h>
+#include "Scheduler.h"
+
+// Deterministic virtual-time Scheduler for simulated runs.
+// Participants it spawns are fibers that all run on the thread inside runUntil(), one at a time: a
+// participant runs until it sleeps, parks or finishes, and handing the CPU to the next one is a user-space
+// context switch rather than an OS thread wake-up. The next runnable participant goes first, in the order
+// they became runnable; when none is left, time jumps straight to the earliest timer, whose task runs on
+// the driving thread between participants. Runs are therefore as fast as the CPU work they contain, and the
+// interleaving depends only on the order of events.
+// Everything here must be called from the driving thread: by participants, by timer tasks, or before
+// runUntil(). Participants must never block that thread (on a mutex held across a park, a future, ...);
+// they wait through park(), Slot or WaitList instead. Finished participants' stacks are reused by the
+// next spawn.
+class VirtualScheduler : public Scheduler {
+public:
+    VirtualScheduler() = default;
+    VirtualScheduler(const VirtualScheduler &) = delete;
+    VirtualScheduler &operator=(const VirtualScheduler &) = delete;
+
+    Clock::time_point now() override;
+    // Virtual time read as time since the Unix epoch, so every simulated node agrees on it.
+    std::chrono::system_clock::time_point wallTime() override;
+    void sleepFor(Clock::duration d) override;
+    void spawn(std::function<void()> task) override;
+    void runAfter(Clock::duration d, std::function<void()> task) override;
+    // Only participants can park; timer tasks run on the driving thread's own stack.
+    void park(Parked &p) override;
+    void resume(Parked &p) override;
+
+    // Runs participants and timers on the calling thread until done() holds, or nothing is left to run.
+    void runUntil(const std::function<bool()> &done);
+
+private:
+    // Big enough for handlers and the JSON they build; the guard page below it turns an overflow into a fault.
+    static constexpr size_t StackSize = 256 * 1024;
+
+    struct Timer {
+        Clock::time_point due;
+        uint64_t seq;
+        std::function<void()> task;
+
+        bool operator>(const Timer &other) const {
+            return due != other.due ? due > other.due : seq > other.seq;
+        }
+    };
+
+    // Where a switched-out participant (or the driving thread) resumes. On x86-64 a switch only saves the
+    // callee-saved registers on the stack being left, so it stays in user space; elsewhere it falls back to
+    // swapcontext, which also saves the signal mask with a system call.
+    struct Context {
+        void *stackPointer = nullptr;
+        ucontext_t fallback{};
+    };
+
+    struct Fiber {
+        Context context;
+        // the stack mapping, guard page included
+        void *mapping = nullptr;
+        std::function<void()> task;
+
+        Fiber();
+        ~Fiber();
+        Fiber(const Fiber &) = delete;
+        Fiber &operator=(const Fiber &) = delete;
+    };
+
+    Clock::time_point time{};
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers;
+    uint64_t nextSeq = 0;
+    std::deque<Fiber *> runnable;
+    // the participant on the CPU; null while the driving thread runs timers
+    Fiber *running = nullptr;
+    Context driver;
+    std::vector<std::unique_ptr<Fiber>> fibers;
+    std::vector<Fiber *> idle;
+
+    // Entry point of every fiber: runs tasks handed to it by spawn(), forever.
+    static void fiberMain();
+    // Saves the current participant or driving thread into from and continues at to.
+    static void switchContext(Context &from, Context &to);
+};
+
+#endif //FLYIO_CHALLENGES_VIRTUALSCHEDULER_H
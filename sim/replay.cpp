@@ -0,0 +1,317 @@
+// Feeds the inbound side of a FLYIO_CAPTURE file back into an in-process node, at the captured pace
+// or faster, to reproduce a production load shape under a profiler without the rest of the cluster.
+// Replies from peers and services are matched to the RPCs the replayed node sends: each captured RPC
+// is paired with the live one that has the same destination and body, and the captured reply is
+// delivered with the live msg_id once the node has sent it. Replay only scans each line's envelope;
+// the node's handleLine is what decodes it.
+// Usage: flyio_replay CAPTURE [--speed X] [--drain-ms N] [--echo] [--verbose]
+// --speed 2 replays twice as fast as captured; 0 feeds every line as soon as the last was dispatched.
+// The node's workload options come from the same FLYIO_* variables as the node binary.
+
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include "JsonReader.h"
+#include "node.h"
+#include "NodeServices.h"
+
+namespace {
+
+struct Options {
+    string capture;
+    double speed = 1;
+    chrono::milliseconds drain{1000};
+    bool echo = false;
+    bool verbose = false;
+};
+
+Options parseArgs(int argc, char **argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto next = [&]() -> string {
+            if (i + 1 >= argc) {
+                throw invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--speed") {
+            o.speed = stod(next());
+        } else if (arg == "--drain-ms") {
+            o.drain = chrono::milliseconds(stol(next()));
+        } else if (arg == "--echo") {
+            o.echo = true;
+        } else if (arg == "--verbose") {
+            o.verbose = true;
+        } else if (o.capture.empty() && !arg.starts_with("--")) {
+            o.capture = arg;
+        } else {
+            throw invalid_argument("unknown argument " + arg);
+        }
+    }
+    if (o.capture.empty()) {
+        throw invalid_argument("no capture file given");
+    }
+    return o;
+}
+
+// What replay reads from a line, pulled out with JsonReader so the node's handleLine is the only full decode.
+struct Envelope {
+    optional<int64_t> msgId;
+    optional<int64_t> inReplyTo;
+    // where in_reply_to's value sits in the line, so a live msg_id can be spliced in
+    size_t inReplyToAt = 0;
+    size_t inReplyToLength = 0;
+};
+
+// The envelope of a line with a string dest, an object body and integer ids, or nullopt for anything
+// else in a capture. With `signature`, also fills in what identifies an RPC across runs: where it went
+// and what it asked, everything but its msg_id, as written.
+optional<Envelope> envelopeOf(const string &line, string *signature = nullptr) {
+    try {
+        Envelope e;
+        bool hasDest = false;
+        bool hasBody = false;
+        string dest;
+        string fields;
+        JsonReader r(line);
+        r.beginObject();
+        while (auto key = r.nextKey()) {
+            if (*key == "dest") {
+                if (r.peek() != JsonReader::Kind::String) {
+                    return nullopt;
+                }
+                dest = r.readString();
+                hasDest = true;
+                continue;
+            }
+            if (*key != "body") {
+                r.skipValue();
+                continue;
+            }
+            if (r.peek() != JsonReader::Kind::Object) {
+                return nullopt;
+            }
+            hasBody = true;
+            r.beginObject();
+            while (auto field = r.nextKey()) {
+                bool isMsgId = *field == "msg_id";
+                bool isInReplyTo = *field == "in_reply_to";
+                if (!isMsgId && signature != nullptr) {
+                    fields.append(*field).append(":");
+                }
+                string_view value = r.skipValue();
+                if (isMsgId || isInReplyTo) {
+                    // a fraction, a string or anything else that is not an integer throws here
+                    int64_t id = JsonReader(value).readInt();
+                    (isMsgId ? e.msgId : e.inReplyTo) = id;
+                    if (isInReplyTo) {
+                        e.inReplyToAt = static_cast<size_t>(value.data() - line.data());
+                        e.inReplyToLength = value.size();
+                    }
+                }
+                if (!isMsgId && signature != nullptr) {
+                    fields.append(value).append(",");
+                }
+            }
+        }
+        r.expectEnd();
+        if (!hasDest || !hasBody) {
+            return nullopt;
+        }
+        if (signature != nullptr) {
+            *signature = dest + '\n' + fields;
+        }
+        return e;
+    } catch (runtime_error &) {
+        return nullopt;
+    }
+}
+
+// `line` with its in_reply_to value replaced by `id`.
+string withInReplyTo(const string &line, const Envelope &e, int64_t id) {
+    return line.substr(0, e.inReplyToAt) + to_string(id) + line.substr(e.inReplyToAt + e.inReplyToLength);
+}
+
+// Pairs captured msg_ids with the ones the live node uses for the same RPCs.
+class ReplyMatcher {
+public:
+    explicit ReplyMatcher(const vector<TrafficRecorder::Entry> &entries) {
+        for (auto &e : entries) {
+            if (e.direction != TrafficRecorder::Direction::Outbound) {
+                continue;
+            }
+            string signature;
+            auto envelope = envelopeOf(e.line, &signature);
+            // outbound lines only feed matching; a broken one just leaves its reply unmatched
+            if (envelope && envelope->msgId) {
+                captured[signature].push_back(*envelope->msgId);
+                unsent.insert(*envelope->msgId);
+            }
+        }
+    }
+
+    // Called with every line the node emits; returns held replies that the line's RPC releases, as lines.
+    vector<string> sent(const string &line) {
+        string signature;
+        auto envelope = envelopeOf(line, &signature);
+        if (!envelope || !envelope->msgId) {
+            return {};
+        }
+        lock_guard<mutex> lock(m);
+        auto it = captured.find(signature);
+        if (it == captured.end() || it->second.empty()) {
+            return {};
+        }
+        int64_t capturedId = it->second.front();
+        it->second.pop_front();
+        unsent.erase(capturedId);
+        liveId[capturedId] = *envelope->msgId;
+        vector<string> released;
+        auto h = held.find(capturedId);
+        if (h != held.end()) {
+            for (auto &[reply, replyEnvelope] : h->second) {
+                released.push_back(withInReplyTo(reply, replyEnvelope, *envelope->msgId));
+                remapped++;
+            }
+            held.erase(h);
+        }
+        return released;
+    }
+
+    // The line to feed for a captured inbound `line` with envelope `e`: the line itself unless it is a
+    // reply that needs the live msg_id; nullopt while the node has not sent the RPC yet.
+    optional<string> received(const string &line, const Envelope &e) {
+        if (!e.inReplyTo) {
+            return line;
+        }
+        int64_t capturedId = *e.inReplyTo;
+        lock_guard<mutex> lock(m);
+        if (auto it = liveId.find(capturedId); it != liveId.end()) {
+            remapped++;
+            return withInReplyTo(line, e, it->second);
+        }
+        if (unsent.contains(capturedId)) {
+            held[capturedId].emplace_back(line, e);
+            return nullopt;
+        }
+        // a reply to nothing the capture shows the node sending; pass it through as captured
+        return line;
+    }
+
+    size_t remappedCount() {
+        lock_guard<mutex> lock(m);
+        return remapped;
+    }
+
+    size_t heldCount() {
+        lock_guard<mutex> lock(m);
+        size_t n = 0;
+        for (auto &[id, replies] : held) {
+            n += replies.size();
+        }
+        return n;
+    }
+
+private:
+    mutex m;
+    unordered_map<string, deque<int64_t>> captured;
+    set<int64_t> unsent;
+    unordered_map<int64_t, int64_t> liveId;
+    unordered_map<int64_t, vector<pair<string, Envelope>>> held;
+    size_t remapped = 0;
+};
+
+vector<TrafficRecorder::Entry> readCapture(const string &path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("cannot read " + path);
+    }
+    vector<TrafficRecorder::Entry> entries;
+    string line;
+    while (getline(in, line)) {
+        if (auto entry = TrafficRecorder::parse(line)) {
+            entries.push_back(move(*entry));
+        }
+    }
+    return entries;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options o;
+    vector<TrafficRecorder::Entry> entries;
+    try {
+        o = parseArgs(argc, argv);
+        entries = readCapture(o.capture);
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        return 2;
+    }
+    if (!o.verbose) {
+        Log::setLevel(LogLevel::Off);
+    }
+
+    auto *matcher = new ReplyMatcher(entries);
+    auto *node = new Node;
+    auto *services = new NodeServices;
+    atomic<size_t> outbound{0};
+    node->output = [&o, &outbound, node, matcher](const string &line) {
+        outbound++;
+        if (o.echo) {
+            lock_guard<mutex> lock(node->outputMutex);
+            cout << line << '\n';
+        }
+        for (auto &reply : matcher->sent(line)) {
+            node->scheduler->spawn([node, reply = move(reply)]() {
+                node->handleLine(reply, node->scheduler->now());
+            });
+        }
+    };
+    services->registerHandlers(*node, ServiceOptions::fromEnv());
+
+    size_t inbound = 0;
+    size_t malformed = 0;
+    clock_t cpuStart = clock();
+    auto start = chrono::steady_clock::now();
+    for (auto &entry : entries) {
+        if (entry.direction != TrafficRecorder::Direction::Inbound) {
+            continue;
+        }
+        if (o.speed > 0) {
+            auto due = start + chrono::duration_cast<chrono::steady_clock::duration>(entry.at / o.speed);
+            this_thread::sleep_until(due);
+        }
+        auto envelope = envelopeOf(entry.line);
+        if (!envelope) {
+            // truncated, corrupted or missing its envelope; skipped rather than fed to the node
+            malformed++;
+            continue;
+        }
+        inbound++;
+        // lines go through handleLine like stdin does, so typed handlers decode them in place and
+        // inbound metrics count them
+        if (auto line = matcher->received(entry.line, *envelope)) {
+            node->scheduler->spawn([node, line = move(*line)]() {
+                node->handleLine(line, node->scheduler->now());
+            });
+        }
+    }
+    double fed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    this_thread::sleep_for(o.drain);
+    double cpu = static_cast<double>(clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    cout << fixed << setprecision(2);
+    cout << "replayed        " << inbound << " inbound lines in " << fed << " s" << endl;
+    if (malformed > 0) {
+        cout << "malformed       " << malformed << " inbound lines skipped" << endl;
+    }
+    cout << "cpu time        " << cpu << " s" << endl;
+    cout << "outbound        " << outbound << " lines" << endl;
+    cout << "replies matched " << matcher->remappedCount() << " (" << matcher->heldCount() << " never sent)" << endl;
+    // handler threads may still be running; skip static destruction under them
+    cout.flush();
+    quick_exit(0);
+}
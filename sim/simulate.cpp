@@ -0,0 +1,422 @@
+// Runs a client workload against an in-process cluster and reports throughput, latency and message cost.
+// Time is virtual: latencies and throughput are in simulated time, next to the CPU time the run took.
+// For broadcast it also reports Maelstrom's stable latency: how long after a value was broadcast every
+// node's read included it, as each node reports the value readable.
+// For txn it reports how many keys still read differently across nodes once replication settles.
+// Usage: flyio_sim [--workload broadcast|log|txn] [--nodes N] [--ops N] [--concurrency N] [--rate OPS_PER_S]
+//                  [--latency-us N] [--jitter-us N] [--loss P] [--seed N] [--topology full|line]
+//                  [--partition-at-ms N --heal-at-ms N] [--causal] [--lin-kv-offsets]
+//                  [--trace PATH] [--json] [--verbose]
+// --topology is what broadcast and txn nodes are told: every other node (the default), or only their
+// neighbours in a chain, like Maelstrom's sparse topologies.
+// --json prints the report as one JSON object (see flyio_workloads).
+// --trace writes a Chrome trace of every node's message flow, on virtual time.
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <set>
+#include <sys/resource.h>
+#include "Simulator.h"
+
+namespace {
+
+struct Options {
+    string workload = "broadcast";
+    size_t nodes = 5;
+    size_t ops = 1000;
+    size_t concurrency = 4;
+    // total requests per second across clients; 0 sends each request as soon as the last one returns
+    double rate = 0;
+    LinkConfig link;
+    uint64_t seed = 1;
+    string topology = "full";
+    int64_t partitionAtMs = -1;
+    int64_t healAtMs = -1;
+    ServiceOptions services;
+    string tracePath;
+    bool json = false;
+    bool verbose = false;
+};
+
+Options parseArgs(int argc, char **argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto next = [&]() -> string {
+            if (i + 1 >= argc) {
+                throw invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--workload") {
+            o.workload = next();
+        } else if (arg == "--nodes") {
+            o.nodes = stoul(next());
+        } else if (arg == "--ops") {
+            o.ops = stoul(next());
+        } else if (arg == "--concurrency") {
+            o.concurrency = max<size_t>(stoul(next()), 1);
+        } else if (arg == "--rate") {
+            o.rate = stod(next());
+        } else if (arg == "--latency-us") {
+            o.link.latency = chrono::microseconds(stol(next()));
+        } else if (arg == "--jitter-us") {
+            o.link.jitter = chrono::microseconds(stol(next()));
+        } else if (arg == "--loss") {
+            o.link.loss = stod(next());
+        } else if (arg == "--seed") {
+            o.seed = stoull(next());
+        } else if (arg == "--topology") {
+            o.topology = next();
+            if (o.topology != "full" && o.topology != "line") {
+                throw invalid_argument("unknown topology " + o.topology);
+            }
+        } else if (arg == "--partition-at-ms") {
+            o.partitionAtMs = stol(next());
+        } else if (arg == "--heal-at-ms") {
+            o.healAtMs = stol(next());
+        } else if (arg == "--causal") {
+            o.services.causalBroadcast = true;
+        } else if (arg == "--lin-kv-offsets") {
+            o.services.linKvOffsets = true;
+        } else if (arg == "--trace") {
+            o.tracePath = next();
+        } else if (arg == "--json") {
+            o.json = true;
+        } else if (arg == "--verbose") {
+            o.verbose = true;
+        } else {
+            throw invalid_argument("unknown argument " + arg);
+        }
+    }
+    return o;
+}
+
+constexpr chrono::milliseconds ClientTimeout{1000};
+// keys the txn workload touches
+constexpr int64_t TxnKeys = 100;
+
+json topologyOf(const vector<string> &ids, const string &kind) {
+    json topology;
+    for (size_t i = 0; i < ids.size(); i++) {
+        topology[ids[i]] = json::array();
+        for (size_t j = 0; j < ids.size(); j++) {
+            bool neighbour = kind == "line" ? i + 1 == j || j + 1 == i : i != j;
+            if (neighbour) {
+                topology[ids[i]].push_back(ids[j]);
+            }
+        }
+    }
+    return topology;
+}
+
+// Generates the i-th request of a workload; `rng` is private to the calling client.
+using Generator = function<pair<string, json>(size_t i, mt19937_64 &rng)>;
+
+Generator workloadGenerator(const Options &o, const vector<string> &ids) {
+    auto pick = [ids](mt19937_64 &rng) {
+        return ids[uniform_int_distribution<size_t>(0, ids.size() - 1)(rng)];
+    };
+    if (o.workload == "broadcast") {
+        return [pick](size_t i, mt19937_64 &rng) {
+            return pair{pick(rng), json{{"type", "broadcast"}, {"message", i}}};
+        };
+    }
+    if (o.workload == "log") {
+        return [pick](size_t i, mt19937_64 &rng) {
+            string key = "k" + to_string(uniform_int_distribution<int>(0, 7)(rng));
+            int roll = uniform_int_distribution<int>(0, 99)(rng);
+            if (roll < 80) {
+                return pair{pick(rng), json{{"type", "send"}, {"key", key}, {"msg", i}}};
+            }
+            if (roll < 95) {
+                return pair{pick(rng), json{{"type", "poll"}, {"offsets", {{key, 0}}}}};
+            }
+            return pair{pick(rng), json{{"type", "commit_offsets"}, {"offsets", {{key, 0}}}}};
+        };
+    }
+    if (o.workload == "txn") {
+        return [pick](size_t i, mt19937_64 &rng) {
+            json txn = json::array();
+            int size = uniform_int_distribution<int>(1, 4)(rng);
+            for (int k = 0; k < size; k++) {
+                int64_t key = uniform_int_distribution<int64_t>(0, TxnKeys - 1)(rng);
+                if (uniform_int_distribution<int>(0, 1)(rng) == 0) {
+                    txn.push_back({"r", key, nullptr});
+                } else {
+                    txn.push_back({"w", key, static_cast<int64_t>(i)});
+                }
+            }
+            return pair{pick(rng), json{{"type", "txn"}, {"txn", txn}}};
+        };
+    }
+    throw invalid_argument("unknown workload " + o.workload);
+}
+
+// When each broadcast value became readable on every node, as the nodes report it.
+class StabilityTracker {
+public:
+    StabilityTracker(Simulator &sim, size_t ops) : sim(sim), sentAt(ops), nodesSeen(ops),
+                                                   seen(sim.nodeIds().size(), vector<bool>(ops)) {}
+
+    void sent(size_t op) {
+        sentAt[op] = sim.scheduler().now();
+    }
+
+    void start() {
+        sim.observeBroadcasts([this](size_t k, int64_t message) {
+            readable(k, message);
+        });
+    }
+
+    // milliseconds from broadcast to visible everywhere, for each value that got there
+    [[nodiscard]] const vector<double> &latencies() const {
+        return stable;
+    }
+
+private:
+    Simulator &sim;
+    vector<Scheduler::Clock::time_point> sentAt;
+    vector<size_t> nodesSeen;
+    vector<vector<bool>> seen;
+    vector<double> stable;
+
+    void readable(size_t k, int64_t message) {
+        if (message < 0 || static_cast<size_t>(message) >= seen[k].size()) {
+            return;
+        }
+        auto op = static_cast<size_t>(message);
+        if (seen[k][op]) {
+            return;
+        }
+        seen[k][op] = true;
+        if (++nodesSeen[op] == seen.size()) {
+            stable.push_back(chrono::duration<double, milli>(sim.scheduler().now() - sentAt[op]).count());
+        }
+    }
+};
+
+struct Percentiles {
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    static Percentiles of(vector<double> values) {
+        sort(values.begin(), values.end());
+        auto at = [&values](double q) {
+            return values[min(values.size() - 1, static_cast<size_t>(q * static_cast<double>(values.size())))];
+        };
+        if (values.empty()) {
+            return {};
+        }
+        return {at(0.5), at(0.99), values.back()};
+    }
+
+    [[nodiscard]] json toJson() const {
+        return {{"p50", p50}, {"p99", p99}, {"max", max}};
+    }
+};
+
+// Every broadcast value should be readable on every node once the network settles.
+size_t missingBroadcasts(Simulator &sim, size_t ops) {
+    size_t missing = 0;
+    for (auto &id : sim.nodeIds()) {
+        auto reply = sim.call("c0", id, {{"type", "read"}}, ClientTimeout);
+        set<size_t> seen;
+        if (reply) {
+            for (auto &m : (*reply)["messages"]) {
+                if (m.is_number_unsigned()) {
+                    seen.insert(m.get<size_t>());
+                }
+            }
+        }
+        for (size_t i = 0; i < ops; i++) {
+            missing += seen.contains(i) ? 0 : 1;
+        }
+    }
+    return missing;
+}
+
+// Replicated txn state should converge: counts the keys some node reads differently from the first one.
+size_t divergedKeys(Simulator &sim) {
+    json reads = json::array();
+    for (int64_t key = 0; key < TxnKeys; key++) {
+        reads.push_back({"r", key, nullptr});
+    }
+    vector<json> values;
+    for (auto &id : sim.nodeIds()) {
+        auto reply = sim.call("c0", id, {{"type", "txn"}, {"txn", reads}}, ClientTimeout);
+        values.push_back(reply && (*reply)["type"] == "txn_ok" ? (*reply)["txn"] : json());
+    }
+    size_t diverged = 0;
+    for (size_t key = 0; key < static_cast<size_t>(TxnKeys); key++) {
+        for (auto &v : values) {
+            if (v.is_null() || values[0].is_null() || v[key] != values[0][key]) {
+                diverged++;
+                break;
+            }
+        }
+    }
+    return diverged;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options o;
+    try {
+        o = parseArgs(argc, argv);
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        return 2;
+    }
+    if (!o.verbose) {
+        Log::setLevel(LogLevel::Off);
+    }
+
+    auto *sim = new Simulator(o.nodes, o.link, o.seed, o.services);
+    shared_ptr<Tracer> tracer;
+    if (!o.tracePath.empty()) {
+        tracer = make_shared<Tracer>(o.tracePath);
+        sim->trace(tracer);
+    }
+    VirtualScheduler &scheduler = sim->scheduler();
+    const vector<string> &ids = sim->nodeIds();
+    Generator generate = workloadGenerator(o, ids);
+
+    size_t failures = 0;
+    vector<double> latencies;
+    double elapsed = 0;
+    size_t missing = 0;
+    size_t diverged = 0;
+    StabilityTracker stability(*sim, o.workload == "broadcast" ? o.ops : 0);
+    clock_t cpuStart = clock();
+    sim->run([&]() {
+        if (o.workload == "broadcast" || o.workload == "txn") {
+            json topology = topologyOf(ids, o.topology);
+            for (auto &id : ids) {
+                sim->call("c0", id, {{"type", "topology"}, {"topology", topology}}, ClientTimeout);
+            }
+        }
+
+        if (o.partitionAtMs >= 0) {
+            scheduler.runAfter(chrono::milliseconds(o.partitionAtMs), [sim]() {
+                const auto &ids = sim->nodeIds();
+                size_t half = ids.size() / 2;
+                sim->partition({{ids.begin(), ids.begin() + half}, {ids.begin() + half, ids.end()}});
+            });
+            if (o.healAtMs >= 0) {
+                scheduler.runAfter(chrono::milliseconds(o.healAtMs), [sim]() {
+                    sim->heal();
+                });
+            }
+        }
+
+        if (o.workload == "broadcast") {
+            stability.start();
+        }
+        auto start = scheduler.now();
+        // with --rate, each client spaces its requests so the clients together offer that many ops/s
+        auto interval = o.rate > 0
+                ? chrono::duration_cast<Scheduler::Clock::duration>(chrono::duration<double>(static_cast<double>(o.concurrency) / o.rate))
+                : Scheduler::Clock::duration::zero();
+        size_t nextOp = 0;
+        size_t running = o.concurrency;
+        Scheduler::Slot finished(scheduler);
+        for (size_t c = 0; c < o.concurrency; c++) {
+            scheduler.spawn([&, c]() {
+                mt19937_64 rng(o.seed * 1000003 + c);
+                string client = "c" + to_string(c + 1);
+                for (size_t i = nextOp++; i < o.ops; i = nextOp++) {
+                    auto [dest, body] = generate(i, rng);
+                    auto sent = scheduler.now();
+                    if (o.workload == "broadcast") {
+                        stability.sent(i);
+                    }
+                    auto reply = sim->call(client, dest, body, ClientTimeout);
+                    latencies.push_back(chrono::duration<double, milli>(scheduler.now() - sent).count());
+                    if (!reply || (*reply)["type"] == "error") {
+                        failures++;
+                    }
+                    auto next = sent + interval;
+                    if (next > scheduler.now()) {
+                        scheduler.sleepFor(next - scheduler.now());
+                    }
+                }
+                if (--running == 0) {
+                    finished.fill(nullptr);
+                }
+            });
+        }
+        finished.take();
+        elapsed = chrono::duration<double>(scheduler.now() - start).count();
+
+        if (o.workload == "broadcast") {
+            // let gossip finish before checking: a lost send costs a retry round (RPC timeout and backoff,
+            // 200 ms), and a value may need several rounds over several hops
+            scheduler.sleepFor(chrono::milliseconds(2000));
+            missing = missingBroadcasts(*sim, o.ops);
+        } else if (o.workload == "txn") {
+            // past a retransmit, so lost batches are resent before checking
+            scheduler.sleepFor(chrono::milliseconds(1500));
+            diverged = divergedKeys(*sim);
+        }
+    });
+    double cpu = static_cast<double>(clock() - cpuStart) / CLOCKS_PER_SEC;
+    if (tracer) {
+        tracer->dump();
+    }
+
+    Percentiles latency = Percentiles::of(latencies);
+    Percentiles stable = Percentiles::of(stability.latencies());
+    Simulator::Stats stats = sim->stats();
+    double throughput = static_cast<double>(o.ops) / max(elapsed, 1e-9);
+    double msgsPerOp = static_cast<double>(stats.nodeMessages) / static_cast<double>(max<size_t>(o.ops, 1));
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    if (o.json) {
+        json report = {
+                {"workload", o.workload}, {"nodes", o.nodes}, {"seed", o.seed}, {"ops", o.ops},
+                {"failures", failures}, {"virtual_s", elapsed}, {"cpu_s", cpu}, {"throughput", throughput},
+                {"latency_ms", latency.toJson()}, {"msgs_per_op", msgsPerOp}, {"dropped", stats.dropped},
+                {"peak_rss_kb", usage.ru_maxrss}
+        };
+        if (o.workload == "broadcast") {
+            report["stable_latency_ms"] = stable.toJson();
+            report["missing"] = missing;
+        } else if (o.workload == "txn") {
+            report["diverged"] = diverged;
+        }
+        cout << report.dump() << endl;
+    } else {
+        cout << fixed << setprecision(2);
+        cout << "workload        " << o.workload << " (" << o.nodes << " nodes, seed " << o.seed << ")" << endl;
+        cout << "ops             " << o.ops << " (" << failures << " failed)" << endl;
+        cout << "virtual time    " << elapsed << " s" << endl;
+        cout << "cpu time        " << cpu << " s" << endl;
+        cout << "peak rss        " << usage.ru_maxrss / 1024.0 << " MiB" << endl;
+        cout << "throughput      " << throughput << " ops/s (virtual)" << endl;
+        cout << "latency p50     " << latency.p50 << " ms" << endl;
+        cout << "latency p99     " << latency.p99 << " ms" << endl;
+        cout << "latency max     " << latency.max << " ms" << endl;
+        if (o.workload == "broadcast") {
+            cout << "stable p50      " << stable.p50 << " ms" << endl;
+            cout << "stable max      " << stable.max << " ms" << endl;
+        }
+        cout << "node msgs/op    " << msgsPerOp << endl;
+        cout << "dropped         " << stats.dropped << endl;
+        if (o.workload == "broadcast") {
+            cout << "missing         " << missing << endl;
+        } else if (o.workload == "txn") {
+            cout << "diverged        " << diverged << endl;
+        }
+    }
+    // nodes keep parked participants and the log thread alive; skip static destruction under them
+    cout.flush();
+    quick_exit(0);
+}